@@ -0,0 +1,54 @@
+// Export throughput of the G-code writer on a long synthetic spline
+//
+// Usage: gcode_benchmark [SEGMENTS] [OUTPUT]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "curve_table.h"
+#include "gcode_export.h"
+#include "tangents.h"
+
+int main(int argc, char** argv) {
+    size_t segments = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    std::string path = argc > 2 ? argv[2] : "benchmark.gcode";
+
+    // Wavy spiral, so the biarcs have all kinds of radii and directions
+    std::vector<glm::dvec2> points;
+    points.reserve(segments + 1);
+    for (size_t i = 0; i <= segments; ++i) {
+        double t = 0.01 * static_cast<double>(i);
+        double r = 100.0 + 0.001 * static_cast<double>(i) +
+                   20.0 * std::sin(7.0 * t);
+        points.push_back(glm::dvec2(r * std::cos(t), r * std::sin(t)));
+    }
+    // One open curve over all points
+    CurveTable curves;
+    curves.addCurve(0, glm::vec4(1.0f));
+    curves.fit(points.size());
+    Tangents tangents;
+    tangents.method = kBessel;
+    tangents.rebuild(points, curves);
+
+    GcodeOptions options;
+    GcodeStats stats;
+    auto start = std::chrono::steady_clock::now();
+    if (!ExportGcode(path, points, tangents.values, curves, options, stats)) {
+        fprintf(stderr, "export failed\n");
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    printf("%zu segments -> %zu arcs, %zu lines, %.1f MB in %.3f s\n",
+           stats.segments, stats.arcs, stats.lines, stats.bytes * 1.e-6,
+           seconds);
+    printf("%.2f M segments/s, %.1f MB/s\n", stats.segments * 1.e-6 / seconds,
+           stats.bytes * 1.e-6 / seconds);
+    return 0;
+}
@@ -0,0 +1,225 @@
+#include "arc_bvh.h"
+
+#include <algorithm>
+
+double BoxDistance(const glm::dvec2& x, const glm::dvec2& lo,
+                   const glm::dvec2& hi) {
+    return glm::length(glm::max(glm::max(lo - x, x - hi), glm::dvec2(0.0)));
+}
+
+namespace {
+
+bool BoxesOverlap(const glm::dvec2& lo0, const glm::dvec2& hi0,
+                  const glm::dvec2& lo1, const glm::dvec2& hi1) {
+    return lo0.x <= hi1.x && lo0.y <= hi1.y && hi0.x >= lo1.x &&
+           hi0.y >= lo1.y;
+}
+
+}  // namespace
+
+void ArcBvh::build(const std::vector<Arc>& source) {
+    arcs = source;
+    nodes.clear();
+    parents.clear();
+    leaves.resize(arcs.size());
+    items.resize(arcs.size());
+    for (size_t i = 0; i < arcs.size(); ++i) {
+        arcs[i].bounds(items[i].lo, items[i].hi);
+        items[i].index = i;
+    }
+    if (arcs.empty()) {
+        return;
+    }
+
+    // Ranges of items still to build, the left child on top so that it
+    // gets the index after its parent
+    struct Task {
+        size_t parent, first, last;
+        bool right;
+    };
+    std::vector<Task> tasks;
+    Task root = {0, 0, items.size(), false};
+    tasks.push_back(root);
+    while (!tasks.empty()) {
+        Task task = tasks.back();
+        tasks.pop_back();
+        size_t index = nodes.size();
+        if (task.right) {
+            nodes[task.parent].first = index;
+        }
+        Node node;
+        node.lo = items[task.first].lo;
+        node.hi = items[task.first].hi;
+        glm::dvec2 centerLo(HUGE_VAL), centerHi(-HUGE_VAL);
+        for (size_t k = task.first; k < task.last; ++k) {
+            node.lo = glm::min(node.lo, items[k].lo);
+            node.hi = glm::max(node.hi, items[k].hi);
+            glm::dvec2 center = 0.5 * (items[k].lo + items[k].hi);
+            centerLo = glm::min(centerLo, center);
+            centerHi = glm::max(centerHi, center);
+        }
+        node.first = task.first;
+        node.count = task.last - task.first;
+        parents.push_back(task.parent);
+        if (node.count <= kLeafSize) {
+            for (size_t k = task.first; k < task.last; ++k) {
+                leaves[items[k].index] = index;
+            }
+            nodes.push_back(node);
+            continue;
+        }
+        node.count = 0;
+        nodes.push_back(node);
+
+        // Median split along the longer extent of the centers
+        int axis = centerHi.x - centerLo.x >= centerHi.y - centerLo.y ? 0 : 1;
+        size_t mid = task.first + (task.last - task.first) / 2;
+        std::nth_element(items.begin() + task.first, items.begin() + mid,
+                         items.begin() + task.last,
+                         [axis](const Item& a, const Item& b) {
+                             return a.lo[axis] + a.hi[axis] <
+                                    b.lo[axis] + b.hi[axis];
+                         });
+        Task right = {index, mid, task.last, true};
+        Task left = {index, task.first, mid, false};
+        tasks.push_back(right);
+        tasks.push_back(left);
+    }
+}
+
+void ArcBvh::overlapping(const glm::dvec2& lo, const glm::dvec2& hi,
+                         std::vector<size_t>& result) const {
+    if (nodes.empty()) {
+        return;
+    }
+    // Median splits keep the depth at log2 of the arc count
+    size_t stack[kMaxDepth];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        size_t index = stack[--top];
+        const Node& node = nodes[index];
+        if (!BoxesOverlap(node.lo, node.hi, lo, hi)) {
+            continue;
+        }
+        if (node.count == 0) {
+            stack[top++] = node.first;
+            stack[top++] = index + 1;
+            continue;
+        }
+        for (size_t k = node.first; k < node.first + node.count; ++k) {
+            if (BoxesOverlap(items[k].lo, items[k].hi, lo, hi)) {
+                result.push_back(items[k].index);
+            }
+        }
+    }
+}
+
+long ArcBvh::nearest(const glm::dvec2& x, double& distance,
+                     double maxDistance) const {
+    long best = -1;
+    distance = maxDistance;
+    if (nodes.empty()) {
+        return best;
+    }
+    size_t stack[kMaxDepth];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        size_t index = stack[--top];
+        const Node& node = nodes[index];
+        if (BoxDistance(x, node.lo, node.hi) >= distance) {
+            continue;
+        }
+        if (node.count == 0) {
+            // Visit the nearer child first
+            size_t left = index + 1, right = node.first;
+            if (BoxDistance(x, nodes[left].lo, nodes[left].hi) <
+                BoxDistance(x, nodes[right].lo, nodes[right].hi)) {
+                std::swap(left, right);
+            }
+            stack[top++] = left;
+            stack[top++] = right;
+            continue;
+        }
+        for (size_t k = node.first; k < node.first + node.count; ++k) {
+            if (BoxDistance(x, items[k].lo, items[k].hi) >= distance) {
+                continue;
+            }
+            double d = arcs[items[k].index].distance(x);
+            if (d < distance) {
+                distance = d;
+                best = static_cast<long>(items[k].index);
+            }
+        }
+    }
+    return best;
+}
+
+bool ArcBvh::anyCloser(const glm::dvec2& x, double distance) const {
+    if (nodes.empty()) {
+        return false;
+    }
+    size_t stack[kMaxDepth];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        size_t index = stack[--top];
+        const Node& node = nodes[index];
+        if (BoxDistance(x, node.lo, node.hi) >= distance) {
+            continue;
+        }
+        if (node.count == 0) {
+            stack[top++] = node.first;
+            stack[top++] = index + 1;
+            continue;
+        }
+        for (size_t k = node.first; k < node.first + node.count; ++k) {
+            if (BoxDistance(x, items[k].lo, items[k].hi) < distance &&
+                arcs[items[k].index].distance(x) < distance) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ArcBvh::refit(size_t i, const Arc& arc) {
+    arcs[i] = arc;
+    size_t index = leaves[i];
+    Node& leaf = nodes[index];
+    for (size_t k = leaf.first; k < leaf.first + leaf.count; ++k) {
+        if (items[k].index == i) {
+            arc.bounds(items[k].lo, items[k].hi);
+        }
+    }
+    leaf.lo = items[leaf.first].lo;
+    leaf.hi = items[leaf.first].hi;
+    for (size_t k = leaf.first + 1; k < leaf.first + leaf.count; ++k) {
+        leaf.lo = glm::min(leaf.lo, items[k].lo);
+        leaf.hi = glm::max(leaf.hi, items[k].hi);
+    }
+    // Up to the root, or to the first node whose box stays the same
+    while (index > 0) {
+        index = parents[index];
+        Node& node = nodes[index];
+        const Node& left = nodes[index + 1];
+        const Node& right = nodes[node.first];
+        glm::dvec2 lo = glm::min(left.lo, right.lo);
+        glm::dvec2 hi = glm::max(left.hi, right.hi);
+        if (lo == node.lo && hi == node.hi) {
+            break;
+        }
+        node.lo = lo;
+        node.hi = hi;
+    }
+}
+
+bool ArcBvh::bounds(glm::dvec2& lo, glm::dvec2& hi) const {
+    if (nodes.empty()) {
+        return false;
+    }
+    lo = nodes[0].lo;
+    hi = nodes[0].hi;
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "biarc.h"
+
+// Distance from x to the box lo ... hi, 0 inside it
+double BoxDistance(const glm::dvec2& x, const glm::dvec2& lo,
+                   const glm::dvec2& hi);
+
+// Bounding volume hierarchy over arcs, for queries that would otherwise
+// test every arc: boxes overlapping a box, and the arc nearest to a point.
+// Nodes are stored depth-first, so the left child follows its parent.
+struct ArcBvh {
+    // Arcs per leaf
+    static const size_t kLeafSize = 4;
+
+    std::vector<Arc> arcs;
+
+    void build(const std::vector<Arc>& arcs);
+    // Append the indices of the arcs whose boxes overlap lo ... hi
+    void overlapping(const glm::dvec2& lo, const glm::dvec2& hi,
+                     std::vector<size_t>& result) const;
+    // Index of the arc nearest to x and its distance, or -1 if there are no
+    // arcs closer than maxDistance
+    long nearest(const glm::dvec2& x, double& distance,
+                 double maxDistance = HUGE_VAL) const;
+    // Whether any arc is closer to x than distance, which stops at the
+    // first one found
+    bool anyCloser(const glm::dvec2& x, double distance) const;
+    // Replace arc i and refit the boxes of its leaf and the nodes above it.
+    // Queries stay exact, but the tree gets looser the farther arcs move
+    // from where they were at the last build.
+    void refit(size_t i, const Arc& arc);
+    // Box of all arcs, false if there are none
+    bool bounds(glm::dvec2& lo, glm::dvec2& hi) const;
+
+   private:
+    // Deeper trees than this would need more arcs than fit in memory
+    static const int kMaxDepth = 64;
+
+    struct Node {
+        glm::dvec2 lo, hi;
+        // Range of items for leaves, otherwise count is 0 and first is the
+        // right child
+        size_t first, count;
+    };
+    // Arc index with its box
+    struct Item {
+        glm::dvec2 lo, hi;
+        size_t index;
+    };
+    std::vector<Node> nodes;
+    // Grouped by leaf
+    std::vector<Item> items;
+    // Parent of each node, and the leaf of each arc
+    std::vector<size_t> parents;
+    std::vector<size_t> leaves;
+};
@@ -0,0 +1,230 @@
+#include "arc_length.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "parallel.h"
+
+namespace {
+
+// Fewest segments or samples a thread gets
+const size_t kChunkSize = 1 << 15;
+
+// Arc in the direction the curve runs through it, parametrized by the arc
+// length l from its start: the angle alpha + beta * l around the center c,
+// or c + direction * l for lines
+struct Piece {
+    bool isLine;
+    glm::dvec2 c, direction;
+    double radius, alpha, beta;
+
+    // The second arc of a biarc is constructed backwards, so it is reversed
+    Piece(const Arc& arc, bool reverse) : isLine(arc.isLine) {
+        if (isLine) {
+            c = reverse ? arc.q : arc.p;
+            glm::dvec2 d = reverse ? arc.p - arc.q : arc.q - arc.p;
+            double length = glm::length(d);
+            direction = length > 0.0 ? d / length : glm::dvec2(0.0);
+            return;
+        }
+        c = arc.c;
+        radius = arc.radius();
+        glm::dvec2 pc = arc.p - arc.c;
+        alpha = std::atan2(pc.y, pc.x) + (reverse ? arc.sweep : 0.0);
+        beta = ((arc.sweep > 0.0) != reverse ? 1.0 : -1.0) / radius;
+    }
+
+    glm::dvec2 tangent(const glm::dvec2& radial) const {
+        return beta > 0.0 ? glm::dvec2(-radial.y, radial.x)
+                          : glm::dvec2(radial.y, -radial.x);
+    }
+
+    // Unit vector from the center of an arc
+    glm::dvec2 radialAt(double l) const {
+        double angle = alpha + beta * l;
+        return glm::dvec2(std::cos(angle), std::sin(angle));
+    }
+
+    glm::dvec2 pointAt(double l, glm::dvec2* t) const {
+        if (isLine) {
+            if (t) {
+                *t = direction;
+            }
+            return c + direction * l;
+        }
+        glm::dvec2 radial = radialAt(l);
+        if (t) {
+            *t = tangent(radial);
+        }
+        return c + radius * radial;
+    }
+};
+
+// Write the samples from k on whose arc lengths k * step fall on the arc,
+// which starts at arc length start, or all up to last if it ends the curve.
+// Advances k past them.
+void SampleArc(const Arc& arc, bool reverse, double start, double end,
+               bool final, double step, size_t& k, size_t last,
+               glm::dvec2* points, glm::vec2* tangents) {
+    if (k >= last || (!final && k * step > end)) {
+        return;
+    }
+    Piece piece(arc, reverse);
+    glm::dvec2 t;
+    if (piece.isLine) {
+        for (; k < last && (final || k * step <= end); ++k) {
+            points[k] = piece.pointAt(k * step - start, &t);
+            tangents[k] = glm::vec2(t);
+        }
+        return;
+    }
+    // Rotate the radial direction from one sample to the next
+    glm::dvec2 radial = piece.radialAt(k * step - start);
+    double delta = piece.beta * step;
+    double cosDelta = std::cos(delta), sinDelta = std::sin(delta);
+    for (; k < last && (final || k * step <= end); ++k) {
+        points[k] = piece.c + piece.radius * radial;
+        tangents[k] = glm::vec2(piece.tangent(radial));
+        radial = glm::dvec2(cosDelta * radial.x - sinDelta * radial.y,
+                            sinDelta * radial.x + cosDelta * radial.y);
+    }
+}
+
+void ResampleRange(const ArcLengthTable& table, double step, size_t first,
+                   size_t last, glm::dvec2* points, glm::vec2* tangents) {
+    size_t segments = table.biarcs.size();
+    size_t segment = table.segmentAt(first * step);
+    for (size_t k = first; k < last && segment < segments; ++segment) {
+        // Skip the segments without samples
+        if (table.knotLengths[segment + 1] < k * step) {
+            segment = table.segmentAt(k * step);
+        }
+        const Biarc& biarc = table.biarcs[segment];
+        double start = table.knotLengths[segment];
+        double joint = start + biarc.a.length();
+        double end = table.knotLengths[segment + 1];
+        bool final = segment + 1 == segments;
+        SampleArc(biarc.a, false, start, joint, false, step, k, last, points,
+                  tangents);
+        SampleArc(biarc.b, true, joint, end, final, step, k, last, points,
+                  tangents);
+    }
+}
+
+}  // namespace
+
+double ArcLengthTable::total() const {
+    return knotLengths.empty() ? 0.0 : knotLengths.back();
+}
+
+void ArcLengthTable::markChanged(size_t first, size_t last) {
+    dirtyFirst = dirty ? std::min(dirtyFirst, first) : first;
+    dirtyLast = dirty ? std::max(dirtyLast, last) : last;
+    dirty = true;
+}
+
+void ArcLengthTable::insert(size_t i, size_t count) {
+    size_t segment = std::min(i, biarcs.size());
+    biarcs.insert(biarcs.begin() + segment, count, Biarc());
+    lengths.insert(lengths.begin() + segment, count, 0.0);
+    knotLengths.insert(knotLengths.begin() + std::min(i, knotLengths.size()),
+                       count, 0.0);
+    markChanged(i > 0 ? i - 1 : 0, i + count);
+}
+
+void ArcLengthTable::erase(size_t i, size_t count) {
+    // Erasing the last knots drops the last segments
+    size_t segments = std::min(count, biarcs.size());
+    size_t segment = std::min(i, biarcs.size() - segments);
+    biarcs.erase(biarcs.begin() + segment,
+                 biarcs.begin() + segment + segments);
+    lengths.erase(lengths.begin() + segment,
+                  lengths.begin() + segment + segments);
+    size_t knot = std::min(i, knotLengths.size());
+    knotLengths.erase(knotLengths.begin() + knot,
+                      knotLengths.begin() +
+                          std::min(knot + count, knotLengths.size()));
+    markChanged(i > 0 ? i - 1 : 0, i);
+}
+
+void ArcLengthTable::update(const std::vector<glm::dvec2>& points,
+                            const std::vector<glm::vec2>& tangents,
+                            const CurveTable& curves) {
+    size_t segments = curves.segmentCount(points.size());
+    if (!dirty && segments == biarcs.size()) {
+        updatedFirst = updatedLast = 0;
+        return;
+    }
+    // Segments begin ... end - 1 need new biarcs
+    size_t begin = segments, end = 0;
+    if (dirty && segments > 0) {
+        begin = dirtyFirst > 0 ? dirtyFirst - 1 : 0;
+        end = std::min(dirtyLast, segments - 1) + 1;
+    }
+    if (segments != biarcs.size()) {
+        begin = std::min(begin, biarcs.size());
+        end = segments;
+    }
+    dirty = false;
+    biarcs.resize(segments);
+    lengths.resize(segments);
+    // A closed last curve ends at its first knot again, one past the points
+    knotLengths.resize(segments > 0 ? segments + 1 : points.size());
+    updatedFirst = std::min(begin, segments);
+    updatedLast = std::max(end, updatedFirst);
+    if (begin >= end) {
+        return;
+    }
+
+    size_t count = end - begin;
+    ParallelChunks(count, ChunkCount(count, kChunkSize),
+                   [&](size_t first, size_t last, size_t) {
+        for (size_t i = begin + first; i < begin + last; ++i) {
+            biarcs[i] = curves.segmentBiarc(points, tangents, i);
+            lengths[i] = biarcs[i].length();
+        }
+    });
+    // The sums before the first changed segment stay
+    knotLengths[0] = 0.0;
+    for (size_t i = begin; i < segments; ++i) {
+        knotLengths[i + 1] = knotLengths[i] + lengths[i];
+    }
+}
+
+size_t ArcLengthTable::segmentAt(double s) const {
+    // Last knot at or before s, the final knot belongs to the last segment
+    size_t i = std::upper_bound(knotLengths.begin() + 1, knotLengths.end() - 1,
+                                s) -
+               knotLengths.begin();
+    return i - 1;
+}
+
+glm::dvec2 ArcLengthTable::pointAt(double s, glm::dvec2* tangent) const {
+    s = glm::clamp(s, 0.0, total());
+    size_t i = segmentAt(s);
+    const Biarc& biarc = biarcs[i];
+    double l = s - knotLengths[i];
+    double la = biarc.a.length();
+    if (l <= la) {
+        return Piece(biarc.a, false).pointAt(l, tangent);
+    }
+    return Piece(biarc.b, true).pointAt(l - la, tangent);
+}
+
+void Resample(const ArcLengthTable& table, size_t count,
+              std::vector<glm::dvec2>& points,
+              std::vector<glm::vec2>& tangents) {
+    points.clear();
+    tangents.clear();
+    if (table.biarcs.empty() || count == 0) {
+        return;
+    }
+    points.resize(count);
+    tangents.resize(count);
+    double step = count > 1 ? table.total() / (count - 1) : 0.0;
+    ParallelChunks(count, ChunkCount(count, kChunkSize),
+                   [&](size_t first, size_t last, size_t) {
+        ResampleRange(table, step, first, last, points.data(),
+                      tangents.data());
+    });
+}
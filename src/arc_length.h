@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "biarc.h"
+#include "curve_table.h"
+
+// Arc length along the biarc spline through the knots. The pieces are circle
+// arcs, so the lengths are exact. The table keeps the biarcs and the length
+// up to each knot, a prefix sum over the segments, and after a change only
+// recomputes the segments that changed and the sums from the first of them.
+// Between two curves there is a biarc of no length, so the lengths of the
+// curves follow each other. A closed curve includes its closing biarc.
+struct ArcLengthTable {
+    std::vector<Biarc> biarcs;
+    // Length from the first knot to knot i, and after the closing biarc of
+    // a closed last curve
+    std::vector<double> knotLengths;
+    // Segments updatedFirst ... updatedLast - 1 got new biarcs in the last
+    // update. The segments after them moved by the change of the segment
+    // count, if any.
+    size_t updatedFirst = 0, updatedLast = 0;
+
+    double total() const;
+    // Knots first ... last moved or changed their tangents, which changes
+    // segments first - 1 ... last. last may lie past the end.
+    void markChanged(size_t first, size_t last);
+    // Knots i ... i + count - 1 were inserted, or the count knots at i were
+    // erased. Shifts the biarcs and lengths after them, so that the next
+    // update only recomputes the segments around the edit.
+    void insert(size_t i, size_t count);
+    void erase(size_t i, size_t count);
+    // Recompute what changed since the last update. Knots that were added or
+    // removed at the end count as changed.
+    void update(const std::vector<glm::dvec2>& points,
+                const std::vector<glm::vec2>& tangents,
+                const CurveTable& curves);
+    // Segment that contains arc length s, in O(log n). Needs two knots.
+    size_t segmentAt(double s) const;
+    // Point at arc length s, clamped to the curve, and its unit tangent in
+    // the direction of the curve. Needs two knots.
+    glm::dvec2 pointAt(double s, glm::dvec2* tangent = nullptr) const;
+
+   private:
+    // Length of each segment
+    std::vector<double> lengths;
+    bool dirty = true;
+    size_t dirtyFirst = 0, dirtyLast = static_cast<size_t>(-1);
+};
+
+// count points spaced evenly along the curve from its first to its last
+// knot, with their unit tangents. Consecutive samples on an arc differ by a
+// fixed rotation, so only the first one on each arc needs trigonometry.
+// Large counts are split into ranges resampled on separate threads.
+void Resample(const ArcLengthTable& table, size_t count,
+              std::vector<glm::dvec2>& points,
+              std::vector<glm::vec2>& tangents);
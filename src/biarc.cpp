@@ -0,0 +1,206 @@
+#include "biarc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+
+namespace {
+
+double cro(const glm::dvec2& a, const glm::dvec2& b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+glm::dvec2 perp(const glm::dvec2& x) { return glm::dvec2(x.y, -x.x); }
+
+bool isFinite(const glm::dvec2& x) {
+    return std::isfinite(x.x) && std::isfinite(x.y);
+}
+
+}  // namespace
+
+double Arc::radius() const { return std::sqrt(r2); }
+
+double Arc::length() const {
+    return isLine ? glm::distance(p, q) : radius() * std::abs(sweep);
+}
+
+glm::dvec2 Arc::pointAt(double u) const {
+    if (isLine) {
+        return p + (q - p) * u;
+    }
+    glm::dvec2 pc = p - c;
+    double angle = std::atan2(pc.y, pc.x) + u * sweep;
+    return c + radius() * glm::dvec2(std::cos(angle), std::sin(angle));
+}
+
+glm::dvec2 Arc::tangentAt(double u) const {
+    if (isLine) {
+        return glm::normalize(q - p);
+    }
+    // The ends need no trigonometry
+    glm::dvec2 x = u == 0.0 ? p : u == 1.0 ? q : pointAt(u);
+    glm::dvec2 radial = (x - c) / radius();
+    // Rotate by 90 degrees in the direction of the sweep
+    return sweep > 0.0 ? glm::dvec2(-radial.y, radial.x)
+                       : glm::dvec2(radial.y, -radial.x);
+}
+
+int Arc::chordCount(double tolerance, int maxChords) const {
+    if (isLine) {
+        return 1;
+    }
+    double r = radius();
+    double maxAngle =
+        tolerance < r ? 2.0 * std::acos(1.0 - tolerance / r) : 1.0;
+    int n = static_cast<int>(std::ceil(std::abs(sweep) / maxAngle));
+    return std::min(std::max(n, 1), maxChords);
+}
+
+bool Arc::inSpan(const glm::dvec2& x) const {
+    glm::dvec2 xc = x - c;
+    // alpha < beta => cos(alpha) > cos(beta), see `circle_arc_sdf`
+    return glm::dot(n, xc) * radius() < glm::dot(n, p - c) * glm::length(xc);
+}
+
+void Arc::bounds(glm::dvec2& lo, glm::dvec2& hi) const {
+    lo = glm::min(p, q);
+    hi = glm::max(p, q);
+    if (isLine) {
+        return;
+    }
+    // Extreme points of the circle, if they are part of the arc
+    double r = radius();
+    const glm::dvec2 extremes[4] = {
+        glm::dvec2(c.x - r, c.y), glm::dvec2(c.x + r, c.y),
+        glm::dvec2(c.x, c.y - r), glm::dvec2(c.x, c.y + r)};
+    for (int i = 0; i < 4; ++i) {
+        if (inSpan(extremes[i])) {
+            lo = glm::min(lo, extremes[i]);
+            hi = glm::max(hi, extremes[i]);
+        }
+    }
+}
+
+double Arc::distance(const glm::dvec2& x) const {
+    if (isLine) {
+        glm::dvec2 d = q - p;
+        double h = glm::clamp(glm::dot(x - p, d) / glm::dot(d, d), 0.0, 1.0);
+        // p == q gives NaN, which clamp does not fix
+        return h == h ? glm::length(x - p - d * h) : glm::distance(x, p);
+    }
+    if (inSpan(x)) {
+        return std::abs(glm::distance(x, c) - radius());
+    }
+    return std::min(glm::distance(x, p), glm::distance(x, q));
+}
+
+double Arc::nearestFraction(const glm::dvec2& x) const {
+    if (isLine) {
+        glm::dvec2 d = q - p;
+        double h = glm::clamp(glm::dot(x - p, d) / glm::dot(d, d), 0.0, 1.0);
+        return h == h ? h : 0.0;
+    }
+    if (!inSpan(x)) {
+        return glm::distance(x, p) <= glm::distance(x, q) ? 0.0 : 1.0;
+    }
+    // Angle from p to x in the direction of the sweep
+    glm::dvec2 pc = p - c;
+    glm::dvec2 xc = x - c;
+    double angle = std::atan2(cro(pc, xc), glm::dot(pc, xc));
+    if (sweep > 0.0 && angle < 0.0) {
+        angle += glm::two_pi<double>();
+    } else if (sweep < 0.0 && angle > 0.0) {
+        angle -= glm::two_pi<double>();
+    }
+    return glm::clamp(angle / sweep, 0.0, 1.0);
+}
+
+double Biarc::distance(const glm::dvec2& x) const {
+    return std::min(a.distance(x), b.distance(x));
+}
+
+double Biarc::length() const { return a.length() + b.length(); }
+
+Arc MakeArc(const glm::dvec2& p, const glm::dvec2& q, const glm::dvec2& t) {
+    Arc arc;
+    arc.p = p;
+    arc.q = q;
+    glm::dvec2 n = perp(t);
+    glm::dvec2 d = q - p;
+    double lambda = 0.5 * glm::dot(d, d) / glm::dot(n, d);
+    arc.c = p + lambda * n;
+    arc.r2 = lambda * lambda * glm::dot(n, n);
+    arc.n = lambda * perp(d);
+    // NaN (p == q) and infinite radii are treated as lines, too
+    arc.isLine = !(arc.r2 <= kLineRadius2);
+    arc.sweep = 0.0;
+    if (!arc.isLine) {
+        glm::dvec2 pc = p - arc.c;
+        glm::dvec2 qc = q - arc.c;
+        arc.sweep = std::atan2(cro(pc, qc), glm::dot(pc, qc));
+        // Take the long way around if the tangent points away from q
+        bool ccw = cro(pc, t) > 0.0;
+        if (ccw && arc.sweep < 0.0) {
+            arc.sweep += glm::two_pi<double>();
+        } else if (!ccw && arc.sweep > 0.0) {
+            arc.sweep -= glm::two_pi<double>();
+        }
+    }
+    return arc;
+}
+
+Biarc MakeBiarc(const glm::dvec2& p0, const glm::dvec2& t0,
+                const glm::dvec2& p1, const glm::dvec2& t1) {
+    // chord given by points on circle
+    glm::dvec2 chord = p0 - p1;
+    // vector along which center must lie
+    glm::dvec2 r = perp(chord);
+    // center of circle describing locus of joint points
+    glm::dvec2 c = 0.5 * ((p0 + p1) + glm::dot(chord, t0 + t1) /
+                                          glm::dot(r, t0 - t1) * r);
+    glm::dvec2 p0_c = p0 - c;
+    double r2 = glm::dot(p0_c, p0_c);
+    double s = cro(p0_c, chord) < 0.0 ? -1.0 : 1.0;
+    glm::dvec2 joint = c + s * std::sqrt(r2) * r / glm::length(r);
+    // Parallel tangents put the locus center at infinity. The joint point
+    // then converges to the chord midpoint.
+    if (!isFinite(joint)) {
+        joint = 0.5 * (p0 + p1);
+    }
+
+    Biarc biarc;
+    biarc.a = MakeArc(p0, joint, t0);
+    biarc.b = MakeArc(p1, joint, -t1);
+    return biarc;
+}
+
+Biarc PointBiarc(const glm::dvec2& p) {
+    Arc arc;
+    arc.p = arc.q = arc.c = p;
+    arc.r2 = 0.0;
+    arc.n = glm::dvec2(0.0);
+    arc.sweep = 0.0;
+    arc.isLine = true;
+    Biarc biarc;
+    biarc.a = biarc.b = arc;
+    return biarc;
+}
+
+Biarc SegmentBiarc(const std::vector<glm::dvec2>& points,
+                   const std::vector<glm::vec2>& tangents, size_t i) {
+    return MakeBiarc(glm::dvec2(points[i]), glm::dvec2(tangents[i]),
+                     glm::dvec2(points[i + 1]), glm::dvec2(tangents[i + 1]));
+}
+
+void BuildBiarcs(const std::vector<glm::dvec2>& points,
+                 const std::vector<glm::vec2>& tangents,
+                 std::vector<Biarc>& biarcs) {
+    biarcs.clear();
+    if (points.size() < 2) {
+        return;
+    }
+    biarcs.reserve(points.size() - 1);
+    for (size_t i = 0; i + 1 < points.size(); ++i) {
+        biarcs.push_back(SegmentBiarc(points, tangents, i));
+    }
+}
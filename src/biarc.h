@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// CPU-side mirror of the biarc construction done in the fragment shader
+// (`circ`, `circle_arc_sdf` and `biarc_sdf`). Keep the two in sync.
+
+// Circle arc starting at p in the direction of the construction tangent and
+// ending at q. Very large circles degenerate into the line segment p-q.
+struct Arc {
+    glm::dvec2 p, q;
+    // Center and squared radius of the circle
+    glm::dvec2 c;
+    double r2;
+    // Bisector of the triangle (p, c, q), pointing away from the arc
+    glm::dvec2 n;
+    // Signed angle swept from p to q, positive from +x towards +y
+    double sweep;
+    bool isLine;
+
+    double radius() const;
+    double length() const;
+    // Point at fraction u of the arc, from p (0) to q (1)
+    glm::dvec2 pointAt(double u) const;
+    // Unit tangent at fraction u in the direction from p to q
+    glm::dvec2 tangentAt(double u) const;
+    // Number of chords needed to stay within the tolerance of the arc
+    int chordCount(double tolerance, int maxChords = 256) const;
+    // Whether the direction from the center to x lies within the arc
+    bool inSpan(const glm::dvec2& x) const;
+    // Axis-aligned bounding box
+    void bounds(glm::dvec2& lo, glm::dvec2& hi) const;
+    // Unsigned distance from x, like `arc_sdf` without the sign
+    double distance(const glm::dvec2& x) const;
+    // Fraction of the point of the arc nearest to x
+    double nearestFraction(const glm::dvec2& x) const;
+};
+
+// Two arcs meeting at the joint point. Note that the second arc is
+// constructed backwards, i.e. it runs from the end point to the joint.
+struct Biarc {
+    Arc a, b;
+
+    double distance(const glm::dvec2& x) const;
+    double length() const;
+};
+
+// Knots with their unit tangents, one biarc between consecutive knots, as
+// the point buffer and the shaders take them with pinned tangents
+struct BiarcCurve {
+    std::vector<glm::dvec2> points;
+    std::vector<glm::vec2> tangents;
+    // Whether the curve returns to its first knot
+    bool closed = false;
+};
+
+// Same threshold as the shader's early out to the line SDF
+const double kLineRadius2 = 1.e8;
+
+Arc MakeArc(const glm::dvec2& p, const glm::dvec2& q, const glm::dvec2& t);
+
+Biarc MakeBiarc(const glm::dvec2& p0, const glm::dvec2& t0,
+                const glm::dvec2& p1, const glm::dvec2& t1);
+
+// Biarc of no length at p
+Biarc PointBiarc(const glm::dvec2& p);
+
+// Biarc between points i and i + 1, given the unit tangents of all points
+Biarc SegmentBiarc(const std::vector<glm::dvec2>& points,
+                   const std::vector<glm::vec2>& tangents, size_t i);
+
+// One biarc between every pair of consecutive points
+void BuildBiarcs(const std::vector<glm::dvec2>& points,
+                 const std::vector<glm::vec2>& tangents,
+                 std::vector<Biarc>& biarcs);
@@ -0,0 +1,177 @@
+#include "biarc_fit.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "biarc.h"
+#include "parallel.h"
+
+namespace {
+
+// Fewest samples a thread fits
+const size_t kChunkSize = 1 << 14;
+// Rotations in radians the refinement tries for the tangent of a knot
+const double kRotations[] = {0.14, -0.14, 0.07, -0.07, 0.035, -0.035,
+                             0.0175, -0.0175};
+// Biarcs much longer than their samples loop where there are no samples
+const double kMaxLengthRatio = 1.1;
+
+glm::dvec2 Rotate(const glm::dvec2& t, double angle) {
+    double c = std::cos(angle), s = std::sin(angle);
+    return glm::dvec2(c * t.x - s * t.y, s * t.x + c * t.y);
+}
+
+// Samples and tangents of one chunk
+struct Span {
+    const std::vector<glm::dvec2>& samples;
+    const std::vector<glm::dvec2>& tangents;
+    size_t offset;
+    double tolerance;
+
+    // Largest distance of the samples between a and b from their biarc,
+    // stopping early once it exceeds limit
+    double error(size_t a, const glm::dvec2& ta, size_t b,
+                 const glm::dvec2& tb, double limit) const {
+        glm::dvec2 pa(samples[a]), pb(samples[b]);
+        Biarc biarc = MakeBiarc(pa, ta, pb, tb);
+        double polyline = 0.0;
+        double result = 0.0;
+        for (size_t i = a + 1; i <= b && result <= limit; ++i) {
+            polyline += glm::distance(glm::dvec2(samples[i - 1]),
+                                      glm::dvec2(samples[i]));
+            if (i < b) {
+                result = std::max(result,
+                                  biarc.distance(glm::dvec2(samples[i])));
+            }
+        }
+        if (biarc.length() > kMaxLengthRatio * polyline + tolerance) {
+            return HUGE_VAL;
+        }
+        return result;
+    }
+
+    bool fits(size_t a, const glm::dvec2& ta, size_t b,
+              const glm::dvec2& tb) const {
+        return error(a, ta, b, tb, tolerance) <= tolerance;
+    }
+
+    glm::dvec2 tangent(size_t i) const { return tangents[i - offset]; }
+};
+
+// Knots of the samples first ... last, both included
+void FitChunk(const std::vector<glm::dvec2>& samples, size_t first,
+              size_t last, double tolerance, TangentMethod method,
+              std::vector<size_t>& knots,
+              std::vector<glm::dvec2>& knotTangents) {
+    std::vector<glm::dvec2> tangents;
+    tangents.reserve(last - first + 1);
+    for (size_t i = first; i <= last; ++i) {
+        tangents.push_back(EstimateTangent(method, samples, i));
+    }
+    Span span = {samples, tangents, first, tolerance};
+
+    // Greedy: grow each span exponentially, then bisect to its longest fit
+    knots.assign(1, first);
+    for (size_t a = first; a < last;) {
+        size_t good = a + 1, step = 1;
+        size_t bad = last + 1;
+        while (good < last) {
+            size_t b = std::min(last, a + 2 * step);
+            if (!span.fits(a, span.tangent(a), b, span.tangent(b))) {
+                bad = b;
+                break;
+            }
+            good = b;
+            step *= 2;
+        }
+        while (bad - good > 1) {
+            size_t b = good + (bad - good) / 2;
+            if (span.fits(a, span.tangent(a), b, span.tangent(b))) {
+                good = b;
+            } else {
+                bad = b;
+            }
+        }
+        knots.push_back(good);
+        a = good;
+    }
+    knotTangents.clear();
+    for (size_t k = 0; k < knots.size(); ++k) {
+        knotTangents.push_back(span.tangent(knots[k]));
+    }
+
+    // Turn the tangents of the inner knots to lower the error of their
+    // spans, the ends stay put to keep the chunks joined
+    for (size_t k = 1; k + 1 < knots.size(); ++k) {
+        size_t a = knots[k - 1], i = knots[k], b = knots[k + 1];
+        const glm::dvec2 &ta = knotTangents[k - 1], &tb = knotTangents[k + 1];
+        double best = std::max(span.error(a, ta, i, knotTangents[k], HUGE_VAL),
+                               span.error(i, knotTangents[k], b, tb, HUGE_VAL));
+        for (double rotation : kRotations) {
+            glm::dvec2 t = Rotate(knotTangents[k], rotation);
+            double error = std::max(span.error(a, ta, i, t, best),
+                                    span.error(i, t, b, tb, best));
+            if (error < best) {
+                best = error;
+                knotTangents[k] = t;
+            }
+        }
+    }
+
+    // Drop the knots whose neighbors now fit with one biarc
+    for (size_t k = 1; k + 1 < knots.size();) {
+        if (span.fits(knots[k - 1], knotTangents[k - 1], knots[k + 1],
+                      knotTangents[k + 1])) {
+            knots.erase(knots.begin() + k);
+            knotTangents.erase(knotTangents.begin() + k);
+        } else {
+            ++k;
+        }
+    }
+}
+
+}  // namespace
+
+void FitBiarcs(const std::vector<glm::dvec2>& samples, size_t first,
+               size_t last, double tolerance, TangentMethod method,
+               std::vector<glm::dvec2>& knots,
+               std::vector<glm::vec2>& knotTangents,
+               std::vector<size_t>* knotSamples) {
+    knots.clear();
+    knotTangents.clear();
+    if (knotSamples) {
+        knotSamples->clear();
+    }
+    if (last <= first) {
+        for (size_t i = first; i <= last; ++i) {
+            knots.push_back(samples[i]);
+            knotTangents.push_back(
+                glm::vec2(EstimateTangent(method, samples, i)));
+            if (knotSamples) {
+                knotSamples->push_back(i);
+            }
+        }
+        return;
+    }
+
+    // Chunks of the spans, each ending at the sample the next starts at
+    size_t spans = last - first;
+    size_t chunks = ChunkCount(spans, kChunkSize);
+    std::vector<std::vector<size_t> > chunkKnots(chunks);
+    std::vector<std::vector<glm::dvec2> > chunkTangents(chunks);
+    ParallelChunks(spans, chunks, [&](size_t a, size_t b, size_t k) {
+        FitChunk(samples, first + a, first + b, tolerance, method,
+                 chunkKnots[k], chunkTangents[k]);
+    });
+
+    // Neighboring chunks share their boundary knot
+    for (size_t k = 0; k < chunks; ++k) {
+        for (size_t i = k == 0 ? 0 : 1; i < chunkKnots[k].size(); ++i) {
+            knots.push_back(samples[chunkKnots[k][i]]);
+            knotTangents.push_back(glm::vec2(chunkTangents[k][i]));
+            if (knotSamples) {
+                knotSamples->push_back(chunkKnots[k][i]);
+            }
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "tangents.h"
+
+// Fit as few biarcs as possible to the dense samples first ... last, such
+// that every sample lies within tolerance pixels of the biarc of its span.
+// The knots are a subset of the samples including both ends, and each gets
+// a unit tangent, so the result renders like any other points with pinned
+// tangents.
+//
+// Spans are grown greedily from the tangents the method estimates on the
+// samples. A refinement pass then turns the tangents of the knots to lower
+// the error of their two spans and merges spans that fit together. Large
+// ranges are split into chunks fitted on separate threads, whose boundaries
+// become knots. knotSamples, if given, gets the sample index of each knot.
+void FitBiarcs(const std::vector<glm::dvec2>& samples, size_t first,
+               size_t last, double tolerance, TangentMethod method,
+               std::vector<glm::dvec2>& knots,
+               std::vector<glm::vec2>& knotTangents,
+               std::vector<size_t>* knotSamples = nullptr);
@@ -0,0 +1,67 @@
+#include "camera.h"
+
+#include <cstddef>
+
+const char* const kViewSource = R"(
+    // World to window pixels, with the view origin split into a float and
+    // the rest of its double
+    uniform vec2 viewOriginHigh;
+    uniform vec2 viewOriginLow;
+    uniform float viewScale;
+
+    vec2 to_view(vec2 p) {
+        return ((p - viewOriginHigh) - viewOriginLow) * viewScale;
+    }
+)";
+
+namespace {
+
+// Limits of the zoom
+const double kMinScale = 1.e-6;
+const double kMaxScale = 1.e6;
+
+}  // namespace
+
+glm::dvec2 Camera::toView(const glm::dvec2& world) const {
+    return (world - origin) * scale;
+}
+
+glm::dvec2 Camera::toWorld(const glm::dvec2& view) const {
+    return origin + view / scale;
+}
+
+void Camera::toView(const std::vector<glm::dvec2>& world,
+                    std::vector<glm::dvec2>& view) const {
+    view.resize(world.size());
+    for (size_t i = 0; i < world.size(); ++i) {
+        view[i] = toView(world[i]);
+    }
+}
+
+void Camera::zoomAt(const glm::dvec2& at, double factor) {
+    glm::dvec2 anchor = toWorld(at);
+    scale = glm::clamp(scale * factor, kMinScale, kMaxScale);
+    origin = anchor - at / scale;
+}
+
+void Camera::pan(const glm::dvec2& delta) { origin -= delta / scale; }
+
+void Camera::visibleBox(int width, int height, glm::dvec2& lo,
+                        glm::dvec2& hi) const {
+    lo = origin;
+    hi = toWorld(glm::dvec2(width, height));
+}
+
+void Camera::bind(GLuint program) const {
+    glm::vec2 high(origin);
+    glm::vec2 low(origin - glm::dvec2(high));
+    glUniform2f(glGetUniformLocation(program, "viewOriginHigh"), high.x,
+                high.y);
+    glUniform2f(glGetUniformLocation(program, "viewOriginLow"), low.x, low.y);
+    glUniform1f(glGetUniformLocation(program, "viewScale"),
+                static_cast<GLfloat>(scale));
+}
+
+bool Camera::operator==(const Camera& other) const {
+    return origin == other.origin && scale == other.scale;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// GLSL declaring the view uniforms and to_view(p), which maps a world
+// position to window pixels. Goes before kPointFetchSource.
+extern const char* const kViewSource;
+
+// Pan and zoom of the window over the world: a world position p shows at
+// window pixel (p - origin) * scale, with y pointing down. The camera is
+// kept in doubles. The shaders get the origin as the sum of two floats and
+// subtract the parts one after the other, so positions lose no more
+// precision than their offset from the view has, wherever the view is.
+struct Camera {
+    // World position of the upper left corner of the window
+    glm::dvec2 origin = glm::dvec2(0.0);
+    // Window pixels per world unit
+    double scale = 1.0;
+
+    glm::dvec2 toView(const glm::dvec2& world) const;
+    glm::dvec2 toWorld(const glm::dvec2& view) const;
+    // Map the points to window pixels
+    void toView(const std::vector<glm::dvec2>& world,
+                std::vector<glm::dvec2>& view) const;
+    // Scale by factor around window pixel at, which keeps its world position
+    void zoomAt(const glm::dvec2& at, double factor);
+    // Move the world by delta window pixels
+    void pan(const glm::dvec2& delta);
+    // World box seen through a window of the given size
+    void visibleBox(int width, int height, glm::dvec2& lo,
+                    glm::dvec2& hi) const;
+    // Set the view uniforms of the program in use
+    void bind(GLuint program) const;
+
+    bool operator==(const Camera& other) const;
+    bool operator!=(const Camera& other) const { return !(*this == other); }
+};
@@ -0,0 +1,73 @@
+#include "crossings.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+typedef std::pair<int, float> Crossing;
+
+void arcCrossings(const Arc& arc, int columns, std::vector<Crossing>& out) {
+    glm::dvec2 lo, hi;
+    arc.bounds(lo, hi);
+    int first = std::max(0, static_cast<int>(std::ceil(lo.x - 0.5)));
+    int last = std::min(columns - 1, static_cast<int>(std::floor(hi.x - 0.5)));
+    if (arc.isLine) {
+        glm::dvec2 e = arc.q - arc.p;
+        for (int col = first; col <= last; ++col) {
+            double x = col + 0.5;
+            // Same half-open interval as `line_polygon_sdf`
+            if ((x > arc.p.x) != (x > arc.q.x)) {
+                double y = arc.p.y + e.y * (x - arc.p.x) / e.x;
+                out.push_back(Crossing(col, static_cast<float>(y)));
+            }
+        }
+        return;
+    }
+    for (int col = first; col <= last; ++col) {
+        double x = col + 0.5;
+        double dx = x - arc.c.x;
+        double y_on_circle = arc.r2 - dx * dx;
+        if (y_on_circle < 0.0) {
+            continue;
+        }
+        y_on_circle = std::sqrt(y_on_circle);
+        glm::dvec2 lower(x, arc.c.y - y_on_circle);
+        glm::dvec2 upper(x, arc.c.y + y_on_circle);
+        if (arc.inSpan(lower)) {
+            out.push_back(Crossing(col, static_cast<float>(lower.y)));
+        }
+        if (arc.inSpan(upper)) {
+            out.push_back(Crossing(col, static_cast<float>(upper.y)));
+        }
+    }
+}
+
+}  // namespace
+
+void CrossingTable::build(const std::vector<Biarc>& biarcs, int columns) {
+    std::vector<Crossing> crossings;
+    for (size_t i = 0; i < biarcs.size(); ++i) {
+        arcCrossings(biarcs[i].a, columns, crossings);
+        arcCrossings(biarcs[i].b, columns, crossings);
+    }
+
+    // Counting sort by column, then sort each column by y
+    offsets.assign(columns + 1, 0);
+    for (size_t i = 0; i < crossings.size(); ++i) {
+        ++offsets[crossings[i].first + 1];
+    }
+    for (int col = 0; col < columns; ++col) {
+        offsets[col + 1] += offsets[col];
+    }
+    values.resize(crossings.size());
+    std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < crossings.size(); ++i) {
+        values[cursor[crossings[i].first]++] = crossings[i].second;
+    }
+    for (int col = 0; col < columns; ++col) {
+        std::sort(values.begin() + offsets[col],
+                  values.begin() + offsets[col + 1]);
+    }
+}
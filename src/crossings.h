@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+
+#include "biarc.h"
+
+// Per-column table of the y-positions where the curve crosses the vertical
+// line through the pixel centers. The shader casts its even-odd ray towards
+// +y, so the fill sign of a fragment is the parity of the crossings below it,
+// which a binary search over the sorted column finds in O(log crossings).
+struct CrossingTable {
+    // Crossings of column x are values[offsets[x]] ... values[offsets[x + 1]]
+    std::vector<int> offsets;
+    std::vector<float> values;
+
+    void build(const std::vector<Biarc>& biarcs, int columns);
+};
@@ -0,0 +1,22 @@
+#include "cursor_capture.h"
+
+void CursorCapture::record(const CursorEvent& event) {
+    if (count == kCapacity) {
+        first = (first + 1) % kCapacity;
+        --count;
+        ++overwritten;
+    }
+    ring[(first + count) % kCapacity] = event;
+    ++count;
+}
+
+size_t CursorCapture::drain(std::vector<CursorEvent>& events) {
+    for (size_t i = 0; i < count; ++i) {
+        events.push_back(ring[(first + i) % kCapacity]);
+    }
+    first = 0;
+    count = 0;
+    size_t result = overwritten;
+    overwritten = 0;
+    return result;
+}
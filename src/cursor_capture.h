@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+struct CursorEvent {
+    // Window coordinates, like ImGui::GetMousePos()
+    glm::dvec2 position;
+    // glfwGetTime() when the event was processed
+    double time;
+    // Whether the left button was down at the time
+    bool pressed;
+};
+
+// Every cursor event GLFW reports, recorded from the cursor position
+// callback into a ring buffer and taken out in one batch per frame. If a
+// frame takes too long, the oldest events are overwritten.
+struct CursorCapture {
+    void record(const CursorEvent& event);
+    // Append the recorded events to events in order and clear the buffer,
+    // returns how many were overwritten since the last drain
+    size_t drain(std::vector<CursorEvent>& events);
+
+   private:
+    static const size_t kCapacity = 4096;
+    CursorEvent ring[kCapacity];
+    // Index of the oldest event
+    size_t first = 0;
+    size_t count = 0;
+    size_t overwritten = 0;
+};
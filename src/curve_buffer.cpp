@@ -0,0 +1,309 @@
+#include "curve_buffer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+const char* const kCurveTableSource = R"(
+    uniform int curveCount;
+    uniform isamplerBuffer curveTable;
+    uniform samplerBuffer curveBounds;
+    // Runs of segments that can show in the view as (curve, first segment,
+    // end segment), ascending
+    uniform int visibleRunCount;
+    uniform isamplerBuffer visibleRuns;
+
+    // Flag of the curves that return to their first point
+    const int CURVE_CLOSED = 1;
+
+    // Last curve that starts at or before point i
+    int curve_at(int i) {
+        int lo = 0;
+        int hi = curveCount - 1;
+        while (lo < hi) {
+            int mid = (lo + hi + 1) / 2;
+            if (texelFetch(curveTable, mid).x <= i) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        return lo;
+    }
+
+    // Segments of a curve entry (first point, point count, flags), one
+    // per point but the last, which only starts one if the curve is closed
+    int curve_segment_count(ivec3 curve) {
+        if (curve.y < 2) {
+            return 0;
+        }
+        return (curve.z & CURVE_CLOSED) != 0 ? curve.y : curve.y - 1;
+    }
+
+    ivec3 visible_run(int k) {
+        return texelFetch(visibleRuns, k).xyz;
+    }
+
+    // Box around the biarcs of curve c in window pixels
+    vec4 curve_box(int c) {
+        return texelFetch(curveBounds, c);
+    }
+
+    vec3 curve_color(int c) {
+        int color = texelFetch(curveTable, c).w;
+        return vec3(color & 0xff, (color >> 8) & 0xff, (color >> 16) & 0xff) /
+               255.0;
+    }
+)";
+
+namespace {
+
+const size_t kMinCapacity = 64;
+// Slack around the boxes for the single precision biarcs of the shaders, in
+// window pixels
+const double kBoundsPadding = 1.0;
+// Window pixels beyond which boxes are clamped, inside the float range
+const double kMaxViewCoordinate = 1.e30;
+// Window pixels beyond which a curve has no effect on the view, besides
+// crossing the even-odd rays: the anti-aliasing, the highlighted points and
+// the candidate band of the tiles
+const double kCullMargin = 16.0;
+// Culled segments at most this far apart in a curve share a run, which
+// keeps the runs few where the view cuts a curve into pieces
+const size_t kRunGap = 8;
+
+size_t SegmentCount(const glm::ivec4& entry) {
+    if (entry.y < 2) {
+        return 0;
+    }
+    return entry.z != 0 ? entry.y : entry.y - 1;
+}
+
+float ClampView(double x) {
+    return static_cast<float>(
+        glm::clamp(x, -kMaxViewCoordinate, kMaxViewCoordinate));
+}
+
+// Box in the window of the camera, padded, empty boxes stay empty
+glm::vec4 ViewBox(const Camera& camera, const glm::dvec4& box) {
+    if (box.x > box.z) {
+        return glm::vec4(glm::vec2(kMaxViewCoordinate),
+                         glm::vec2(-kMaxViewCoordinate));
+    }
+    glm::dvec2 lo = camera.toView(glm::dvec2(box.x, box.y)) - kBoundsPadding;
+    glm::dvec2 hi = camera.toView(glm::dvec2(box.z, box.w)) + kBoundsPadding;
+    return glm::vec4(ClampView(lo.x), ClampView(lo.y), ClampView(hi.x),
+                     ClampView(hi.y));
+}
+
+GLint PackColor(const glm::vec4& color) {
+    glm::vec4 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+    uint32_t packed = static_cast<uint32_t>(c.r) |
+                      static_cast<uint32_t>(c.g) << 8 |
+                      static_cast<uint32_t>(c.b) << 16 |
+                      static_cast<uint32_t>(c.a) << 24;
+    return static_cast<GLint>(packed);
+}
+
+}  // namespace
+
+void CurveBuffer::init() {
+    glGenBuffers(1, &tableTbo);
+    glGenTextures(1, &tableTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, tableTbo);
+    glBindTexture(GL_TEXTURE_BUFFER, tableTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32I, tableTbo);
+
+    glGenBuffers(1, &boundsTbo);
+    glGenTextures(1, &boundsTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, boundsTbo);
+    glBindTexture(GL_TEXTURE_BUFFER, boundsTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, boundsTbo);
+
+    glGenBuffers(1, &visibleTbo);
+    glGenTextures(1, &visibleTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, visibleTbo);
+    glBindTexture(GL_TEXTURE_BUFFER, visibleTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32I, visibleTbo);
+}
+
+void CurveBuffer::update(const CurveTable& table) {
+    size_t count = table.curves.size();
+    std::vector<glm::ivec4> newEntries(count);
+    std::vector<glm::dvec4> newBoxes(count);
+    for (size_t c = 0; c < count; ++c) {
+        const Curve& curve = table.curves[c];
+        newEntries[c] = glm::ivec4(static_cast<GLint>(curve.first),
+                                   static_cast<GLint>(curve.count),
+                                   curve.closed ? 1 : 0,
+                                   PackColor(curve.color));
+        newBoxes[c] = glm::dvec4(curve.lo, curve.hi);
+    }
+
+    // Changed curves first ... last - 1
+    size_t first = 0;
+    size_t shared = std::min(count, entries.size());
+    while (first < shared && newEntries[first] == entries[first]) {
+        ++first;
+    }
+    size_t last = count;
+    while (last > first && last <= shared &&
+           newEntries[last - 1] == entries[last - 1]) {
+        --last;
+    }
+    if (first < last || count != entries.size() || newBoxes != boxes) {
+        culled = false;
+    }
+    entries.swap(newEntries);
+    boxes.swap(newBoxes);
+    const Curve* back = count > 0 ? &table.curves.back() : nullptr;
+    segmentCount = back ? table.segmentCount(back->first + back->count) : 0;
+
+    if (count > capacity) {
+        capacity = std::max(kMinCapacity, count + count / 2);
+        glBindBuffer(GL_TEXTURE_BUFFER, tableTbo);
+        glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(glm::ivec4), NULL,
+                     GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, boundsTbo);
+        glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(glm::vec4), NULL,
+                     GL_DYNAMIC_DRAW);
+        // The next cull uploads all boxes
+        viewBoxes.clear();
+        culled = false;
+        first = 0;
+        last = count;
+    }
+    if (first >= last) {
+        return;
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, tableTbo);
+    glBufferSubData(GL_TEXTURE_BUFFER, first * sizeof(glm::ivec4),
+                    (last - first) * sizeof(glm::ivec4), &entries[first]);
+}
+
+void CurveBuffer::cull(const Camera& camera, int width, int height,
+                       const CurvePicker& picker) {
+    if (culled && camera == culledCamera && width == culledWidth &&
+        height == culledHeight && &picker == culledPicker &&
+        picker.generation() == culledGeneration) {
+        return;
+    }
+    culled = true;
+    culledCamera = camera;
+    culledWidth = width;
+    culledHeight = height;
+    culledPicker = &picker;
+    culledGeneration = picker.generation();
+
+    glm::dvec2 lo, hi;
+    camera.visibleBox(width, height, lo, hi);
+    glm::dvec2 margin(kCullMargin / camera.scale);
+    lo -= margin;
+    hi += margin;
+    // The even-odd rays run from the view towards +y without end
+    hi.y = std::numeric_limits<double>::max();
+    std::vector<glm::ivec4> newRuns;
+    if (picker.segments() == segmentCount) {
+        std::vector<std::pair<size_t, size_t> > segments;
+        picker.overlapping(lo, hi, segments);
+        // Split the runs of the picker at the curves
+        size_t c = 0;
+        for (size_t k = 0; k < segments.size(); ++k) {
+            GLint first = static_cast<GLint>(segments[k].first);
+            GLint last = static_cast<GLint>(segments[k].second);
+            while (c + 1 < entries.size() && entries[c + 1].x <= first) {
+                ++c;
+            }
+            while (first < last) {
+                // The last point of an open curve starts no segment
+                GLint end = std::min(
+                    last, entries[c].x +
+                              static_cast<GLint>(SegmentCount(entries[c])));
+                GLint curve = static_cast<GLint>(c);
+                bool merge = !newRuns.empty() && newRuns.back().x == curve &&
+                             first <= newRuns.back().z +
+                                          static_cast<GLint>(kRunGap);
+                if (first < end && merge) {
+                    newRuns.back().z = std::max(newRuns.back().z, end);
+                } else if (first < end) {
+                    newRuns.push_back(glm::ivec4(curve, first, end, 0));
+                }
+                if (c + 1 >= entries.size() || entries[c + 1].x >= last) {
+                    break;
+                }
+                ++c;
+                first = std::max(first, entries[c].x);
+            }
+        }
+    } else {
+        for (size_t c = 0; c < boxes.size(); ++c) {
+            const glm::dvec4& box = boxes[c];
+            if (box.z >= lo.x && box.x <= hi.x && box.w >= lo.y) {
+                GLint first = entries[c].x;
+                newRuns.push_back(glm::ivec4(
+                    static_cast<GLint>(c), first,
+                    first + static_cast<GLint>(SegmentCount(entries[c])), 0));
+            }
+        }
+    }
+
+    // Boxes of the curves in the window of the camera
+    std::vector<glm::vec4> newViewBoxes(boxes.size());
+    for (size_t c = 0; c < boxes.size(); ++c) {
+        newViewBoxes[c] = ViewBox(camera, boxes[c]);
+    }
+    if (newViewBoxes != viewBoxes && !newViewBoxes.empty()) {
+        glBindBuffer(GL_TEXTURE_BUFFER, boundsTbo);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0,
+                        newViewBoxes.size() * sizeof(glm::vec4),
+                        newViewBoxes.data());
+    }
+    viewBoxes.swap(newViewBoxes);
+
+    if (newRuns == runs) {
+        return;
+    }
+    runs.swap(newRuns);
+    glBindBuffer(GL_TEXTURE_BUFFER, visibleTbo);
+    if (runs.size() > runCapacity) {
+        runCapacity = std::max(kMinCapacity, runs.size() + runs.size() / 2);
+        glBufferData(GL_TEXTURE_BUFFER, runCapacity * sizeof(glm::ivec4),
+                     NULL, GL_DYNAMIC_DRAW);
+    }
+    if (!runs.empty()) {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, runs.size() * sizeof(glm::ivec4),
+                        runs.data());
+    }
+}
+
+void CurveBuffer::bind(GLuint program) const {
+    glActiveTexture(GL_TEXTURE8);
+    glBindTexture(GL_TEXTURE_BUFFER, tableTexture);
+    glActiveTexture(GL_TEXTURE9);
+    glBindTexture(GL_TEXTURE_BUFFER, boundsTexture);
+    glActiveTexture(GL_TEXTURE10);
+    glBindTexture(GL_TEXTURE_BUFFER, visibleTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(program, "curveTable"), 8);
+    glUniform1i(glGetUniformLocation(program, "curveBounds"), 9);
+    glUniform1i(glGetUniformLocation(program, "visibleRuns"), 10);
+    glUniform1i(glGetUniformLocation(program, "curveCount"),
+                static_cast<GLint>(entries.size()));
+    glUniform1i(glGetUniformLocation(program, "visibleRunCount"),
+                static_cast<GLint>(runs.size()));
+}
+
+size_t CurveBuffer::gpuBytes() const {
+    return capacity * (sizeof(glm::ivec4) + sizeof(glm::vec4)) +
+           runCapacity * sizeof(glm::ivec4);
+}
+
+void CurveBuffer::cleanup() {
+    glDeleteBuffers(1, &tableTbo);
+    glDeleteTextures(1, &tableTexture);
+    glDeleteBuffers(1, &boundsTbo);
+    glDeleteTextures(1, &boundsTexture);
+    glDeleteBuffers(1, &visibleTbo);
+    glDeleteTextures(1, &visibleTexture);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "camera.h"
+#include "curve_pick.h"
+#include "curve_table.h"
+
+// GLSL declaring the curve table samplers with curve_at(i), which finds the
+// curve of point i, curve_segment_count(entry), visible_run(k),
+// curve_box(c) in window pixels and curve_color(c). Goes after
+// kPointFetchSource.
+extern const char* const kCurveTableSource;
+
+// GPU copy of the curve table as two buffer textures: the first point,
+// point count, flags and color of every curve as RGBA32I, and the box around
+// its biarcs as RGBA32F. The boxes stay in doubles on the CPU and go up in
+// window pixels of the camera of the last cull, so they keep their
+// precision far from the world origin. The shaders loop over the curves and
+// skip the ones whose box is too far away. The curve of a segment, such as a
+// tile candidate, is found by a binary search over the first points, so
+// there is no per-segment table to rewrite when points are inserted or
+// erased.
+//
+// A third buffer lists the runs of segments that can affect the view,
+// culled on the CPU by the arc boxes of a curve picker over the same
+// curves, so the loops of the shaders skip the rest of the world and the
+// parts of the visible curves that lie off the view.
+struct CurveBuffer {
+    void init();
+    // Upload the range of curves whose entries changed since the last update
+    void update(const CurveTable& table);
+    // List the segments whose arcs come near the view of the camera or lie
+    // beyond it in +y, where the even-odd rays pass, merged into runs per
+    // curve. Takes whole curves by their boxes if the picker doesn't follow
+    // the curves. Also moves the boxes into the window of the camera, so
+    // draws go through the camera of their cull. Keeps the last result while
+    // the camera, the window, the picker and the table stay the same.
+    void cull(const Camera& camera, int width, int height,
+              const CurvePicker& picker);
+    // Bind the textures to units 8, 9 and 10 and set the samplers and the
+    // curve counts of the program in use
+    void bind(GLuint program) const;
+    size_t gpuBytes() const;
+    void cleanup();
+
+   private:
+    GLuint tableTbo, tableTexture;
+    GLuint boundsTbo, boundsTexture;
+    GLuint visibleTbo, visibleTexture;
+    // Curves the buffers have room for
+    size_t capacity = 0;
+    // What the buffers hold
+    std::vector<glm::ivec4> entries;
+    // Boxes in world units as (lo, hi), and in window pixels as uploaded
+    std::vector<glm::dvec4> boxes;
+    std::vector<glm::vec4> viewBoxes;
+    size_t segmentCount = 0;
+    // Curve, first segment and end segment of every visible run
+    std::vector<glm::ivec4> runs;
+    size_t runCapacity = 0;
+    // What the last cull went by, culled is cleared by table changes
+    bool culled = false;
+    Camera culledCamera;
+    int culledWidth = 0, culledHeight = 0;
+    const CurvePicker* culledPicker = nullptr;
+    uint64_t culledGeneration = 0;
+};
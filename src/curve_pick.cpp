@@ -0,0 +1,180 @@
+#include "curve_pick.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "parallel.h"
+
+namespace {
+
+// Append segments first ... end - 1 to ascending runs
+void AddRun(std::vector<std::pair<size_t, size_t> >& runs, size_t first,
+            size_t end) {
+    if (!runs.empty() && first <= runs.back().second) {
+        runs.back().second = std::max(runs.back().second, end);
+    } else {
+        runs.push_back(std::make_pair(first, end));
+    }
+}
+
+}  // namespace
+
+void CurvePicker::update(const ArcLengthTable& table) {
+    size_t segments = table.biarcs.size();
+    size_t first = table.updatedFirst, last = table.updatedLast;
+    if (segments == segmentCount && first == last) {
+        return;
+    }
+    ++updateCount;
+    if (chunks.empty() || segments == 0 || 2 * (last - first) > segments) {
+        rebuild(table, 0, chunks.size(), 0, segments);
+        segmentCount = segments;
+        return;
+    }
+    if (segments == segmentCount) {
+        for (size_t i = first; i < last; ++i) {
+            Chunk& chunk = chunks[chunkAt(i)];
+            size_t j = 2 * (i - chunk.first);
+            chunk.bvh.refit(j, table.biarcs[i].a);
+            chunk.bvh.refit(j + 1, table.biarcs[i].b);
+            chunk.bvh.bounds(chunk.lo, chunk.hi);
+        }
+        return;
+    }
+
+    // Segments first ... last - 1 replace the old ones up to oldLast - 1,
+    // and the ones after them moved
+    size_t oldLast = last + segmentCount - segments;
+    size_t a = chunkAt(std::min(first, segmentCount - 1));
+    size_t b =
+        chunkAt(std::min(std::max(oldLast, first + 1), segmentCount) - 1) + 1;
+    size_t begin = chunks[a].first;
+    size_t end = b < chunks.size() ? chunks[b].first : segmentCount;
+    // Take the next chunk along instead of leaving a small one behind
+    if (end + segments - segmentCount - begin < kChunkSize / 4 &&
+        b < chunks.size()) {
+        ++b;
+        end = b < chunks.size() ? chunks[b].first : segmentCount;
+    }
+    for (size_t c = b; c < chunks.size(); ++c) {
+        chunks[c].first += segments - segmentCount;
+    }
+    rebuild(table, a, b, begin, end + segments - segmentCount);
+    segmentCount = segments;
+}
+
+bool CurvePicker::pick(const ArcLengthTable& table, const glm::dvec2& x,
+                       double maxDistance, CurvePick& result) const {
+    // Chunks whose boxes are close enough, nearest first
+    std::vector<std::pair<double, size_t>> candidates;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        double d = BoxDistance(x, chunks[c].lo, chunks[c].hi);
+        if (d < maxDistance) {
+            candidates.push_back(std::make_pair(d, c));
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    const Chunk* best = nullptr;
+    long index = -1;
+    result.distance = maxDistance;
+    for (size_t k = 0; k < candidates.size(); ++k) {
+        if (candidates[k].first >= result.distance) {
+            break;
+        }
+        const Chunk& chunk = chunks[candidates[k].second];
+        double distance;
+        long i = chunk.bvh.nearest(x, distance, result.distance);
+        if (i >= 0) {
+            best = &chunk;
+            index = i;
+            result.distance = distance;
+        }
+    }
+    if (!best) {
+        return false;
+    }
+
+    const Arc& arc = best->bvh.arcs[index];
+    double u = arc.nearestFraction(x);
+    result.point = arc.pointAt(u);
+    result.segment = best->first + index / 2;
+    result.arc = index % 2;
+    result.length = table.knotLengths[result.segment];
+    // The second arc is constructed from the second knot backwards
+    if (result.arc == 0) {
+        result.u = u;
+        result.length += u * arc.length();
+    } else {
+        result.u = 1.0 - u;
+        result.length += table.biarcs[result.segment].a.length() +
+                         result.u * arc.length();
+    }
+    return true;
+}
+
+void CurvePicker::overlapping(
+    const glm::dvec2& lo, const glm::dvec2& hi,
+    std::vector<std::pair<size_t, size_t> >& runs) const {
+    runs.clear();
+    std::vector<size_t> arcs;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        const Chunk& chunk = chunks[c];
+        if (chunk.hi.x < lo.x || chunk.lo.x > hi.x || chunk.hi.y < lo.y ||
+            chunk.lo.y > hi.y) {
+            continue;
+        }
+        if (chunk.lo.x >= lo.x && chunk.hi.x <= hi.x && chunk.lo.y >= lo.y &&
+            chunk.hi.y <= hi.y) {
+            size_t end =
+                c + 1 < chunks.size() ? chunks[c + 1].first : segmentCount;
+            AddRun(runs, chunk.first, end);
+            continue;
+        }
+        arcs.clear();
+        chunk.bvh.overlapping(lo, hi, arcs);
+        // The chunks are ascending, so sorting the arcs of each one is
+        // enough. Both arcs of a segment may overlap, the runs merge them.
+        std::sort(arcs.begin(), arcs.end());
+        for (size_t k = 0; k < arcs.size(); ++k) {
+            size_t i = chunk.first + arcs[k] / 2;
+            AddRun(runs, i, i + 1);
+        }
+    }
+}
+
+size_t CurvePicker::chunkAt(size_t segment) const {
+    return std::upper_bound(chunks.begin(), chunks.end(), segment,
+                            [](size_t segment, const Chunk& chunk) {
+                                return segment < chunk.first;
+                            }) -
+           chunks.begin() - 1;
+}
+
+void CurvePicker::rebuild(const ArcLengthTable& table, size_t a, size_t b,
+                          size_t first, size_t last) {
+    size_t count = (last - first + kChunkSize - 1) / kChunkSize;
+    std::vector<Chunk> built(count);
+    auto build = [&](size_t begin, size_t end) {
+        std::vector<Arc> arcs;
+        for (size_t c = begin; c < end; ++c) {
+            Chunk& chunk = built[c];
+            chunk.first = first + (last - first) * c / count;
+            size_t chunkLast = first + (last - first) * (c + 1) / count;
+            arcs.clear();
+            for (size_t i = chunk.first; i < chunkLast; ++i) {
+                arcs.push_back(table.biarcs[i].a);
+                arcs.push_back(table.biarcs[i].b);
+            }
+            chunk.bvh.build(arcs);
+            chunk.bvh.bounds(chunk.lo, chunk.hi);
+        }
+    };
+    // Whole curves are built on one thread per core
+    ParallelChunks(count, ChunkCount(count, 4),
+                   [&](size_t begin, size_t end, size_t) { build(begin, end); });
+
+    chunks.erase(chunks.begin() + a, chunks.begin() + b);
+    chunks.insert(chunks.begin() + a, std::make_move_iterator(built.begin()),
+                  std::make_move_iterator(built.end()));
+}
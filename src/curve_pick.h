@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+
+#include "arc_bvh.h"
+#include "arc_length.h"
+
+// Point of the spline nearest to a position
+struct CurvePick {
+    glm::dvec2 point;
+    double distance;
+    size_t segment;
+    // 0 for the arc from the segment's first knot to the joint, 1 for the
+    // arc from the joint to the second knot
+    int arc;
+    // Fraction along the arc in the direction of the curve
+    double u;
+    // Arc length from the first knot
+    double length;
+};
+
+// Finds the point of the spline nearest to a position. The segments of an
+// arc length table are split into chunks, each with a bounding volume
+// hierarchy over its arcs, where arc 2 * j + k is arc k of the chunk's
+// segment j. Moved knots refit the boxes of their arcs, and inserted or
+// erased knots only rebuild the chunks around the edit.
+struct CurvePicker {
+    // Most segments per chunk
+    static const size_t kChunkSize = 1024;
+
+    // Follow the last update of the table
+    void update(const ArcLengthTable& table);
+    // Nearest point closer than maxDistance, false if there is none
+    bool pick(const ArcLengthTable& table, const glm::dvec2& x,
+              double maxDistance, CurvePick& result) const;
+    // Segments with an arc whose box overlaps the box lo ... hi, as
+    // ascending runs of first ... end - 1. Chunks inside the box come whole,
+    // without a walk of their hierarchies.
+    void overlapping(const glm::dvec2& lo, const glm::dvec2& hi,
+                     std::vector<std::pair<size_t, size_t> >& runs) const;
+    // Segments of the table at the last update
+    size_t segments() const { return segmentCount; }
+    // Count of the updates that changed something, to tell whether results
+    // taken before are still current
+    uint64_t generation() const { return updateCount; }
+
+   private:
+    struct Chunk {
+        size_t first;
+        ArcBvh bvh;
+        glm::dvec2 lo, hi;
+    };
+    std::vector<Chunk> chunks;
+    size_t segmentCount = 0;
+    uint64_t updateCount = 0;
+
+    size_t chunkAt(size_t segment) const;
+    // Replace chunks a ... b - 1 by chunks over segments first ... last - 1
+    void rebuild(const ArcLengthTable& table, size_t a, size_t b,
+                 size_t first, size_t last);
+};
@@ -0,0 +1,214 @@
+#include "curve_table.h"
+
+#include <algorithm>
+
+namespace {
+
+void AddBox(const Arc& arc, glm::dvec2& lo, glm::dvec2& hi) {
+    glm::dvec2 arcLo, arcHi;
+    arc.bounds(arcLo, arcHi);
+    lo = glm::min(lo, arcLo);
+    hi = glm::max(hi, arcHi);
+}
+
+// Grow the box by the points first ... last and the segments they start
+void AddRange(const CurveTable& table, const std::vector<glm::dvec2>& points,
+              const std::vector<glm::vec2>& tangents, size_t first,
+              size_t last, glm::dvec2& lo, glm::dvec2& hi) {
+    for (size_t i = first; i <= last; ++i) {
+        lo = glm::min(lo, points[i]);
+        hi = glm::max(hi, points[i]);
+        if (table.joins(i)) {
+            Biarc biarc = table.segmentBiarc(points, tangents, i);
+            AddBox(biarc.a, lo, hi);
+            AddBox(biarc.b, lo, hi);
+        }
+    }
+}
+
+// Biarc from point i to point end
+Biarc JoinBiarc(const std::vector<glm::dvec2>& points,
+                const std::vector<glm::vec2>& tangents, size_t i, size_t end) {
+    return MakeBiarc(glm::dvec2(points[i]), glm::dvec2(tangents[i]),
+                     glm::dvec2(points[end]), glm::dvec2(tangents[end]));
+}
+
+}  // namespace
+
+size_t CurveTable::curveAt(size_t i) const {
+    // Last curve that starts at or before i
+    std::vector<Curve>::const_iterator it = std::upper_bound(
+        curves.begin(), curves.end(), i,
+        [](size_t point, const Curve& curve) { return point < curve.first; });
+    return it == curves.begin() ? 0 : it - curves.begin() - 1;
+}
+
+size_t CurveTable::segmentCount(size_t pointCount) const {
+    if (pointCount == 0) {
+        return 0;
+    }
+    bool closedLast = !curves.empty() && curves.back().closed &&
+                      curves.back().count > 1 &&
+                      curves.back().first + curves.back().count == pointCount;
+    return closedLast ? pointCount : pointCount - 1;
+}
+
+size_t CurveTable::segmentEnd(size_t i) const {
+    if (curves.empty()) {
+        return i;
+    }
+    const Curve& curve = curves[curveAt(i)];
+    size_t end = curve.first + curve.count;
+    if (i + 1 < end) {
+        return i + 1;
+    }
+    if (i + 1 == end && curve.closed && curve.count > 1) {
+        return curve.first;
+    }
+    return i;
+}
+
+bool CurveTable::joins(size_t i) const { return segmentEnd(i) != i; }
+
+size_t CurveTable::seamNeighbors(size_t first, size_t last,
+                                 size_t points[2]) const {
+    if (curves.empty() || first > last) {
+        return 0;
+    }
+    size_t count = 0;
+    // The curves in between lie within the range with both of their ends
+    size_t ends[2] = {curveAt(first), curveAt(last)};
+    for (size_t k = 0; k < (ends[0] == ends[1] ? 1 : 2); ++k) {
+        // Only curves of more than two points wrap their tangents
+        const Curve& curve = curves[ends[k]];
+        size_t end = curve.first + curve.count;
+        if (!curve.closed || curve.count <= 2) {
+            continue;
+        }
+        bool firstChanged = curve.first >= first && curve.first <= last;
+        bool lastChanged = end - 1 >= first && end - 1 <= last;
+        if (firstChanged && !lastChanged) {
+            points[count++] = end - 1;
+        } else if (lastChanged && !firstChanged) {
+            points[count++] = curve.first;
+        }
+    }
+    return count;
+}
+
+void CurveTable::addCurve(size_t pointCount, const glm::vec4& color) {
+    fit(pointCount);
+    if (curves.back().count > 0) {
+        curves.push_back(Curve());
+        curves.back().first = pointCount;
+    }
+    curves.back().color = color;
+}
+
+void CurveTable::fit(size_t pointCount) {
+    while (!curves.empty() && curves.back().first > pointCount) {
+        curves.pop_back();
+    }
+    if (curves.empty()) {
+        curves.push_back(Curve());
+    }
+    curves.back().count = pointCount - curves.back().first;
+}
+
+void CurveTable::insert(size_t i, size_t count) {
+    if (curves.empty()) {
+        curves.push_back(Curve());
+    }
+    size_t c = i > 0 ? curveAt(i - 1) : 0;
+    curves[c].count += count;
+    for (size_t k = c + 1; k < curves.size(); ++k) {
+        curves[k].first += count;
+    }
+}
+
+void CurveTable::erase(size_t i, size_t count) {
+    if (curves.empty()) {
+        return;
+    }
+    size_t c = curveAt(i);
+    count = std::min(count, curves[c].first + curves[c].count - i);
+    curves[c].count -= count;
+    for (size_t k = c + 1; k < curves.size(); ++k) {
+        curves[k].first -= count;
+    }
+    if (curves[c].count == 0 && curves.size() > 1) {
+        curves.erase(curves.begin() + c);
+    }
+}
+
+bool CurveTable::closedFill() const {
+    for (size_t c = 0; c < curves.size(); ++c) {
+        if (curves[c].count > 1 && !curves[c].closed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Biarc CurveTable::segmentBiarc(const std::vector<glm::dvec2>& points,
+                               const std::vector<glm::vec2>& tangents,
+                               size_t i) const {
+    size_t end = segmentEnd(i);
+    return end != i ? JoinBiarc(points, tangents, i, end)
+                    : PointBiarc(glm::dvec2(points[i]));
+}
+
+void CurveTable::updateBounds(const std::vector<glm::dvec2>& points,
+                              const std::vector<glm::vec2>& tangents,
+                              size_t first, size_t last) {
+    if (points.empty() || curves.empty() || first >= points.size()) {
+        return;
+    }
+    // The segment before the first point changed, too
+    first = first > 0 ? first - 1 : 0;
+    last = std::min(last, points.size() - 1);
+    size_t lastCurve = curveAt(last);
+    for (size_t c = curveAt(first); c <= lastCurve; ++c) {
+        Curve& curve = curves[c];
+        size_t end = curve.first + curve.count;
+        if (curve.count <= kExactBoundsCount ||
+            (first <= curve.first && last + 1 >= end)) {
+            curve.lo = Curve().lo;
+            curve.hi = Curve().hi;
+            if (curve.count == 0) {
+                continue;
+            }
+            AddRange(*this, points, tangents, curve.first, end - 1, curve.lo,
+                     curve.hi);
+        } else {
+            AddRange(*this, points, tangents,
+                     std::max(first, curve.first), std::min(last, end - 1),
+                     curve.lo, curve.hi);
+        }
+    }
+}
+
+void BuildBiarcs(const std::vector<glm::dvec2>& points,
+                 const std::vector<glm::vec2>& tangents,
+                 const CurveTable& curves, std::vector<Biarc>& biarcs) {
+    biarcs.clear();
+    size_t segments = curves.segmentCount(points.size());
+    if (segments == 0) {
+        return;
+    }
+    biarcs.reserve(segments);
+    for (size_t c = 0; c < curves.curves.size(); ++c) {
+        const Curve& curve = curves.curves[c];
+        size_t end = std::min(curve.first + curve.count, points.size());
+        for (size_t i = curve.first; i < end && biarcs.size() < segments;
+             ++i) {
+            if (i + 1 < end) {
+                biarcs.push_back(SegmentBiarc(points, tangents, i));
+            } else if (curve.closed && curve.count > 1) {
+                biarcs.push_back(JoinBiarc(points, tangents, i, curve.first));
+            } else {
+                biarcs.push_back(PointBiarc(glm::dvec2(points[i])));
+            }
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "biarc.h"
+
+// One curve of the scene, a run of consecutive points of the point list
+struct Curve {
+    size_t first = 0, count = 0;
+    // Whether the curve returns to its first point
+    bool closed = false;
+    glm::vec4 color = glm::vec4(1.0f);
+    // Box around the knots and biarcs of the curve, empty while lo > hi
+    glm::dvec2 lo = glm::dvec2(1.e300), hi = glm::dvec2(-1.e300);
+};
+
+// Splits the point list into independent curves. Segment i starts at point
+// i and ends at point i + 1 if both belong to the same curve. The last
+// point of a closed curve starts the closing segment back to its first
+// point instead, so a closed last curve adds one segment past the points.
+// Only the last curve may be empty, it is the one new points are appended
+// to.
+struct CurveTable {
+    // Boxes of curves with more points than this only grow on edits instead
+    // of being recomputed, so that an edit stays local
+    static const size_t kExactBoundsCount = 4096;
+
+    std::vector<Curve> curves;
+
+    // Curve that point i belongs to, in O(log curves)
+    size_t curveAt(size_t i) const;
+    // Number of segments of pointCount points, including the gaps between
+    // the curves
+    size_t segmentCount(size_t pointCount) const;
+    // Point segment i ends at, or i if it lies between two curves
+    size_t segmentEnd(size_t i) const;
+    // Whether segment i belongs to a curve
+    bool joins(size_t i) const;
+    // Points outside first ... last whose tangents depend on them across
+    // the seam of a closed curve, at most one for each of the two curves
+    // at the ends of the range. Returns how many there are.
+    size_t seamNeighbors(size_t first, size_t last, size_t points[2]) const;
+    // Start an empty curve at the end for the points appended next, unless
+    // the last curve is still empty
+    void addCurve(size_t pointCount, const glm::vec4& color);
+    // Let the last curve take over the points appended to or removed from
+    // the end, so that the curves cover pointCount points
+    void fit(size_t pointCount);
+    // count points were inserted at i into the curve of point i - 1, or the
+    // count points at i were erased from their curve, which is dropped if
+    // it becomes empty
+    void insert(size_t i, size_t count);
+    void erase(size_t i, size_t count);
+    // Whether every curve with a segment is closed, which is what makes the
+    // even-odd fill well defined
+    bool closedFill() const;
+    // Biarc of segment i, or a biarc of no length at point i between two
+    // curves, which adds nothing to distances, crossings or lengths
+    Biarc segmentBiarc(const std::vector<glm::dvec2>& points,
+                       const std::vector<glm::vec2>& tangents,
+                       size_t i) const;
+    // Fit the boxes of the curves after points first ... last moved or
+    // changed their tangents. Large curves only grow by the boxes of the
+    // changed segments.
+    void updateBounds(const std::vector<glm::dvec2>& points,
+                      const std::vector<glm::vec2>& tangents, size_t first,
+                      size_t last);
+};
+
+// One biarc per segment of the curves, with biarcs of no length between the
+// curves, so that biarc i still starts at point i
+void BuildBiarcs(const std::vector<glm::dvec2>& points,
+                 const std::vector<glm::vec2>& tangents,
+                 const CurveTable& curves, std::vector<Biarc>& biarcs);
@@ -0,0 +1,247 @@
+#include "gcode_export.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <glm/gtc/constants.hpp>
+
+#include "biarc.h"
+
+namespace {
+
+const int kMaxDecimals = 9;
+const int64_t kPowersOfTen[kMaxDecimals + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+    1000000000};
+// Arcs with a chord of at most this many output units become G1 moves,
+// where rounding would make the radii at the two ends disagree
+const int64_t kMinArcChord = 2;
+
+// Writes the moves of one toolpath, keeping the position as rounded to the
+// output precision, which the I/J offsets are relative to
+struct Toolpath {
+    GcodeWriter& writer;
+    const GcodeOptions& options;
+    GcodeStats& stats;
+    double unit;
+    int64_t x, y;
+
+    Toolpath(GcodeWriter& writer, const GcodeOptions& options,
+             GcodeStats& stats)
+        : writer(writer),
+          options(options),
+          stats(stats),
+          unit(1.0 / kPowersOfTen[options.decimals]),
+          x(0),
+          y(0) {}
+
+    glm::dvec2 machine(const glm::dvec2& p) const {
+        return options.scale * glm::dvec2(p.x, options.flipY ? -p.y : p.y);
+    }
+
+    int64_t quantize(double value) const {
+        return static_cast<int64_t>(std::llround(value / unit));
+    }
+
+    void start(const glm::dvec2& p) {
+        glm::dvec2 m = machine(p);
+        x = quantize(m.x);
+        y = quantize(m.y);
+        writer.text("G0");
+        writer.word('X', x * unit, options.decimals);
+        writer.word('Y', y * unit, options.decimals);
+        writer.newline();
+    }
+
+    void line(const glm::dvec2& p) {
+        glm::dvec2 m = machine(p);
+        int64_t qx = quantize(m.x), qy = quantize(m.y);
+        if (qx == x && qy == y) {
+            return;
+        }
+        x = qx;
+        y = qy;
+        writer.text("G1");
+        writer.word('X', x * unit, options.decimals);
+        writer.word('Y', y * unit, options.decimals);
+        writer.newline();
+        ++stats.lines;
+    }
+
+    // Circular move to p around c, sweeping in the direction of the sign
+    // of sweep in screen coordinates
+    void circular(const glm::dvec2& p, const glm::dvec2& c, double sweep) {
+        glm::dvec2 m = machine(p);
+        int64_t qx = quantize(m.x), qy = quantize(m.y);
+        if (std::abs(qx - x) <= kMinArcChord &&
+            std::abs(qy - y) <= kMinArcChord) {
+            line(p);
+            return;
+        }
+        glm::dvec2 center = machine(c);
+        double i = center.x - x * unit, j = center.y - y * unit;
+        x = qx;
+        y = qy;
+        // Flipping y turns counterclockwise into clockwise
+        writer.text((sweep > 0.0) != options.flipY ? "G3" : "G2");
+        writer.word('X', x * unit, options.decimals);
+        writer.word('Y', y * unit, options.decimals);
+        writer.word('I', i, options.decimals, true);
+        writer.word('J', j, options.decimals, true);
+        writer.newline();
+        ++stats.arcs;
+    }
+
+    // The arc from p to q, or from q to p if reverse is set
+    void arc(const Arc& arc, bool reverse) {
+        glm::dvec2 end = reverse ? arc.p : arc.q;
+        if (arc.isLine) {
+            line(end);
+            return;
+        }
+        double sweep = reverse ? -arc.sweep : arc.sweep;
+        if (std::abs(sweep) > glm::pi<double>()) {
+            circular(arc.pointAt(0.5), arc.c, sweep);
+        }
+        circular(end, arc.c, sweep);
+    }
+};
+
+}  // namespace
+
+bool GcodeWriter::open(const std::string& path) {
+    close();
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        fprintf(stderr, "Cannot open %s\n", path.c_str());
+        return false;
+    }
+    // Blocks are buffered here already
+    setvbuf(file, nullptr, _IONBF, 0);
+    used = written = 0;
+    failed = false;
+    return true;
+}
+
+bool GcodeWriter::close() {
+    if (!file) {
+        return false;
+    }
+    flush();
+    failed |= fclose(file) != 0;
+    file = nullptr;
+    return !failed;
+}
+
+void GcodeWriter::flush() {
+    if (used > 0 && fwrite(buffer.data(), 1, used, file) != used) {
+        failed = true;
+    }
+    written += used;
+    used = 0;
+}
+
+void GcodeWriter::text(const char* s) {
+    while (*s) {
+        put(*s++);
+    }
+}
+
+void GcodeWriter::number(double value, int decimals) {
+    decimals = glm::clamp(decimals, 0, kMaxDecimals);
+    int64_t scale = kPowersOfTen[decimals];
+    int64_t fixed = static_cast<int64_t>(std::llround(value * scale));
+    if (fixed < 0) {
+        put('-');
+        fixed = -fixed;
+    }
+    // Integer digits, then the fraction without trailing zeros
+    char digits[24];
+    int count = 0;
+    int64_t integer = fixed / scale;
+    do {
+        digits[count++] = static_cast<char>('0' + integer % 10);
+        integer /= 10;
+    } while (integer > 0);
+    while (count > 0) {
+        put(digits[--count]);
+    }
+    int64_t fraction = fixed % scale;
+    if (fraction == 0) {
+        return;
+    }
+    while (fraction % 10 == 0) {
+        fraction /= 10;
+        --decimals;
+    }
+    for (int k = 0; k < decimals; ++k) {
+        digits[count++] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+    }
+    put('.');
+    while (count > 0) {
+        put(digits[--count]);
+    }
+}
+
+void GcodeWriter::word(char axis, double value, int decimals, bool omitZero) {
+    if (omitZero &&
+        std::llround(value * kPowersOfTen[glm::clamp(
+                                 decimals, 0, kMaxDecimals)]) == 0) {
+        return;
+    }
+    put(' ');
+    put(axis);
+    number(value, decimals);
+}
+
+bool ExportGcode(const std::string& path, const std::vector<glm::dvec2>& points,
+                 const std::vector<glm::vec2>& tangents,
+                 const CurveTable& curves, const GcodeOptions& options,
+                 GcodeStats& stats) {
+    stats = GcodeStats();
+    GcodeWriter writer;
+    if (!writer.open(path)) {
+        return false;
+    }
+    GcodeOptions clamped = options;
+    clamped.decimals = glm::clamp(options.decimals, 0, kMaxDecimals);
+    Toolpath toolpath(writer, clamped, stats);
+
+    writer.text("; ecurves biarc toolpath\nG21 G90 G17\n");
+    bool started = false;
+    for (size_t c = 0; c < curves.curves.size(); ++c) {
+        const Curve& curve = curves.curves[c];
+        size_t end = std::min(curve.first + curve.count, points.size());
+        if (curve.first >= end) {
+            continue;
+        }
+        toolpath.start(glm::dvec2(points[curve.first]));
+        if (!started) {
+            writer.text("F");
+            writer.number(options.feedRate, 1);
+            writer.newline();
+            started = true;
+        }
+        // A closed curve continues with its closing segment
+        bool closed = curve.closed && curve.count > 1 &&
+                      curve.first + curve.count == end;
+        for (size_t i = curve.first; i + 1 < end || (closed && i < end); ++i) {
+            Biarc biarc =
+                i + 1 < end
+                    ? SegmentBiarc(points, tangents, i)
+                    : MakeBiarc(glm::dvec2(points[i]), glm::dvec2(tangents[i]),
+                                glm::dvec2(points[curve.first]),
+                                glm::dvec2(tangents[curve.first]));
+            // The second arc is constructed from the end point backwards
+            toolpath.arc(biarc.a, false);
+            toolpath.arc(biarc.b, true);
+            ++stats.segments;
+        }
+    }
+    writer.text("M2\n");
+    stats.bytes = writer.bytesWritten();
+    return writer.close();
+}
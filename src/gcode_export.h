@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "curve_table.h"
+
+// Settings of the G-code export
+struct GcodeOptions {
+    // Millimeters per pixel
+    double scale = 0.1;
+    // Feed rate in millimeters per minute
+    double feedRate = 1000.0;
+    // Digits after the decimal point
+    int decimals = 4;
+    // Screen y points down, machine y up
+    bool flipY = true;
+};
+
+// Output buffered in a fixed block, which is written out whenever it fills
+// up, so the memory use does not depend on the size of the toolpath
+struct GcodeWriter {
+    static const size_t kBufferSize = 1 << 20;
+
+    GcodeWriter() : buffer(kBufferSize) {}
+    ~GcodeWriter() { close(); }
+
+    bool open(const std::string& path);
+    // Flush and close, false if any write failed
+    bool close();
+
+    void text(const char* s);
+    // Fixed-point number with the given digits after the decimal point
+    void number(double value, int decimals);
+    // Axis word such as "X12.5", or nothing for a value of zero if
+    // omitZero is set
+    void word(char axis, double value, int decimals, bool omitZero = false);
+    void newline() { put('\n'); }
+
+    size_t bytesWritten() const { return written + used; }
+
+   private:
+    std::vector<char> buffer;
+    size_t used = 0;
+    size_t written = 0;
+    FILE* file = nullptr;
+    bool failed = false;
+
+    void put(char c) {
+        if (used == buffer.size()) {
+            flush();
+        }
+        buffer[used++] = c;
+    }
+    void flush();
+};
+
+// Statistics of an export
+struct GcodeStats {
+    // Biarc segments, and the G1/G2/G3 moves they became
+    size_t segments = 0;
+    size_t lines = 0;
+    size_t arcs = 0;
+    size_t bytes = 0;
+};
+
+// Write the biarc splines of the curves as one toolpath, with a rapid move
+// to the start of each curve. Closed curves end with their closing biarc.
+// Each biarc becomes two G2/G3 moves with the arc centers given as I/J offsets from
+// the start, or G1 moves where the construction degenerates into lines.
+// Arcs longer than a half turn are split, and moves that vanish at the
+// output precision are dropped.
+bool ExportGcode(const std::string& path, const std::vector<glm::dvec2>& points,
+                 const std::vector<glm::vec2>& tangents,
+                 const CurveTable& curves, const GcodeOptions& options,
+                 GcodeStats& stats);
@@ -0,0 +1,211 @@
+#include "jump_flood.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "shader.h"
+
+namespace {
+
+const char* seedVertexSource = R"(
+    #version 330 core
+    layout (location = 0) in vec2 aPos;
+    layout (location = 1) in float aSegment;
+
+    uniform vec2 windowSize;
+
+    out vec2 texelPos;
+    flat out float segment;
+
+    void main() {
+        // Window pixels have their origin in the upper left corner
+        texelPos = vec2(aPos.x, windowSize.y - aPos.y);
+        segment = aSegment;
+        gl_Position = vec4(2.0 * texelPos / windowSize - 1.0, 0.0, 1.0);
+    }
+)";
+
+const char* seedFragmentSource = R"(
+    #version 330 core
+    in vec2 texelPos;
+    flat in float segment;
+    out vec4 seed;
+
+    void main() {
+        seed = vec4(texelPos, segment, 1.0);
+    }
+)";
+
+// Full-screen triangle without any vertex data
+const char* floodVertexSource = R"(
+    #version 330 core
+    void main() {
+        vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+        gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+    }
+)";
+
+const char* floodFragmentSource = R"(
+    #version 330 core
+    uniform sampler2D seeds;
+    uniform int stepSize;
+    out vec4 nearest;
+
+    void main() {
+        ivec2 size = textureSize(seeds, 0);
+        ivec2 texel = ivec2(gl_FragCoord.xy);
+        nearest = vec4(0.0);
+        float best = float(0xffffffffU);
+        for (int y = -1; y <= 1; ++y) {
+            for (int x = -1; x <= 1; ++x) {
+                ivec2 other = texel + ivec2(x, y) * stepSize;
+                if (any(lessThan(other, ivec2(0))) ||
+                    any(greaterThanEqual(other, size))) {
+                    continue;
+                }
+                vec4 seed = texelFetch(seeds, other, 0);
+                float d = distance(seed.xy, gl_FragCoord.xy);
+                if (seed.w > 0.0 && d < best) {
+                    best = d;
+                    nearest = seed;
+                }
+            }
+        }
+    }
+)";
+
+void addSpans(const Arc& arc, float segment, double tolerance,
+              std::vector<float>& vertices) {
+    int n = arc.chordCount(tolerance);
+    glm::dvec2 prev = arc.p;
+    for (int i = 1; i <= n; ++i) {
+        glm::dvec2 next = i == n ? arc.q : arc.pointAt(double(i) / n);
+        const float span[] = {
+            static_cast<float>(prev.x), static_cast<float>(prev.y), segment,
+            static_cast<float>(next.x), static_cast<float>(next.y), segment};
+        vertices.insert(vertices.end(), span, span + 6);
+        prev = next;
+    }
+}
+
+}  // namespace
+
+void JumpFlood::init() {
+    seedProgram = CreateProgram(seedVertexSource, &seedFragmentSource, 1);
+    floodProgram = CreateProgram(floodVertexSource, &floodFragmentSource, 1);
+
+    glGenVertexArrays(1, &spanVAO);
+    glGenBuffers(1, &spanVBO);
+    glBindVertexArray(spanVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, spanVBO);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
+                          (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
+                          (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    // Core profile needs a bound VAO even without attributes
+    glGenVertexArrays(1, &emptyVAO);
+
+    glGenFramebuffers(1, &fbo);
+    glGenTextures(2, textures);
+}
+
+void JumpFlood::setBiarcs(const std::vector<Biarc>& biarcs) {
+    std::vector<float> vertices;
+    for (size_t i = 0; i < biarcs.size(); ++i) {
+        float segment = static_cast<float>(i);
+        addSpans(biarcs[i].a, segment, tolerance, vertices);
+        addSpans(biarcs[i].b, segment, tolerance, vertices);
+    }
+    vertexCount = static_cast<GLsizei>(vertices.size() / 3);
+
+    glBindBuffer(GL_ARRAY_BUFFER, spanVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float),
+                 vertices.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    dirty = true;
+}
+
+void JumpFlood::resize(int newWidth, int newHeight) {
+    width = newWidth;
+    height = newHeight;
+    for (int i = 0; i < 2; ++i) {
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA,
+                     GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    dirty = true;
+}
+
+void JumpFlood::update(int newWidth, int newHeight) {
+    if (newWidth != width || newHeight != height) {
+        resize(newWidth, newHeight);
+    }
+    if (!dirty) {
+        return;
+    }
+    dirty = false;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+
+    // Rasterize the spans as seeds
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           textures[0], 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Jump flood framebuffer incomplete" << std::endl;
+    }
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glUseProgram(seedProgram);
+    glUniform2f(glGetUniformLocation(seedProgram, "windowSize"),
+                static_cast<GLfloat>(width), static_cast<GLfloat>(height));
+    glBindVertexArray(spanVAO);
+    glDrawArrays(GL_LINES, 0, vertexCount);
+
+    // Flood with halving step sizes, plus one extra pass of step 1 which
+    // fixes most of the remaining errors
+    int stepSize = 1;
+    while (stepSize * 2 < std::max(width, height)) {
+        stepSize *= 2;
+    }
+    glUseProgram(floodProgram);
+    glUniform1i(glGetUniformLocation(floodProgram, "seeds"), 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(emptyVAO);
+    result = 0;
+    bool extraPass = true;
+    while (stepSize >= 1) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, textures[1 - result], 0);
+        glBindTexture(GL_TEXTURE_2D, textures[result]);
+        glUniform1i(glGetUniformLocation(floodProgram, "stepSize"), stepSize);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        result = 1 - result;
+        if (stepSize == 1 && extraPass) {
+            extraPass = false;
+        } else {
+            stepSize /= 2;
+        }
+    }
+
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void JumpFlood::cleanup() {
+    glDeleteProgram(seedProgram);
+    glDeleteProgram(floodProgram);
+    glDeleteVertexArrays(1, &spanVAO);
+    glDeleteVertexArrays(1, &emptyVAO);
+    glDeleteBuffers(1, &spanVBO);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(2, textures);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include "biarc.h"
+
+// Distance field engine independent of the segment count: the biarcs are
+// tessellated into short spans, rasterized as seeds and propagated with the
+// jump flooding algorithm in O(pixels * log(resolution)).
+//
+// Every texel of the result holds the nearest seed as (x, y, segment, 1) in
+// texel space, i.e. with y pointing up, or w = 0 if there is no seed.
+struct JumpFlood {
+    // Maximum deviation of the spans from the arcs in pixels
+    float tolerance = 0.25f;
+
+    GLuint texture() const { return textures[result]; }
+
+    void init();
+    // Tessellate the biarcs, called when the curve changes
+    void setBiarcs(const std::vector<Biarc>& biarcs);
+    // Re-run the flood if the curve or the size changed since the last run
+    void update(int width, int height);
+    void cleanup();
+
+   private:
+    GLuint seedProgram, floodProgram;
+    GLuint spanVAO, spanVBO, emptyVAO;
+    GLuint fbo, textures[2];
+    int result = 0;
+    int width = 0, height = 0;
+    GLsizei vertexCount = 0;
+    bool dirty = true;
+
+    void resize(int newWidth, int newHeight);
+};
@@ -0,0 +1,287 @@
+#include "lod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include "biarc.h"
+#include "arc_bvh.h"
+#include "biarc_fit.h"
+
+namespace {
+
+// Most times a curve is refitted with half the tolerance before it keeps
+// its full points at a level
+const int kFitAttempts = 3;
+// Most chords per arc when sampling, far above what a zoomed out level
+// needs
+const int kMaxChords = 1 << 16;
+
+// Points along curve c, knots included, no further apart along the arcs
+// than their chords sag by spacing, so that a fit within a tolerance of
+// the samples is within tolerance + spacing of the arcs between them. A
+// closed curve ends with its first knot again.
+void CurveSamples(const std::vector<glm::dvec2>& points,
+                  const std::vector<glm::vec2>& tangents,
+                  const CurveTable& curves, size_t c, double spacing,
+                  std::vector<glm::dvec2>& samples) {
+    const Curve& curve = curves.curves[c];
+    size_t end = curve.first + curve.count;
+    size_t segmentEnd = curve.closed ? end : end - 1;
+    samples.clear();
+    for (size_t i = curve.first; i < segmentEnd; ++i) {
+        Biarc biarc = curves.segmentBiarc(points, tangents, i);
+        // The second arc is constructed from the second knot backwards
+        int n = biarc.a.chordCount(spacing, kMaxChords);
+        for (int k = 0; k < n; ++k) {
+            samples.push_back(biarc.a.pointAt(double(k) / n));
+        }
+        n = biarc.b.chordCount(spacing, kMaxChords);
+        for (int k = n; k > 0; --k) {
+            samples.push_back(biarc.b.pointAt(double(k) / n));
+        }
+    }
+    samples.push_back(points[curve.closed ? curve.first : end - 1]);
+}
+
+// Whether the fitted biarcs stay within error of the arcs of the full
+// curve, checked at points whose chords sag by at most spacing
+bool FollowsCurve(const ArcBvh& bvh, const std::vector<glm::dvec2>& knots,
+                  const std::vector<glm::vec2>& knotTangents, bool closed,
+                  double error, double spacing) {
+    size_t segments = closed ? knots.size() : knots.size() - 1;
+    for (size_t i = 0; i < segments; ++i) {
+        size_t j = (i + 1) % knots.size();
+        Biarc biarc = MakeBiarc(glm::dvec2(knots[i]),
+                                glm::dvec2(knotTangents[i]),
+                                glm::dvec2(knots[j]),
+                                glm::dvec2(knotTangents[j]));
+        for (const Arc* arc : {&biarc.a, &biarc.b}) {
+            int n = arc->chordCount(spacing, kMaxChords);
+            for (int k = 0; k <= n; ++k) {
+                if (!bvh.anyCloser(arc->pointAt(double(k) / n),
+                                   error - spacing)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Knots and pinned tangents of curve c within error of its arcs, or its
+// full points where no fit is
+void FitCurve(const std::vector<glm::dvec2>& points,
+              const Tangents& tangents, const CurveTable& curves, size_t c,
+              const ArcBvh& bvh, double error,
+              std::vector<glm::dvec2>& knots,
+              std::vector<glm::vec2>& knotTangents) {
+    const Curve& curve = curves.curves[c];
+    // A quarter of the error goes to the sampling of either curve
+    double spacing = 0.25 * error;
+    std::vector<glm::dvec2> samples;
+    CurveSamples(points, tangents.values, curves, c, spacing, samples);
+    double tolerance = error - 2.0 * spacing;
+    for (int attempt = 0; attempt < kFitAttempts; ++attempt) {
+        FitBiarcs(samples, 0, samples.size() - 1, tolerance, tangents.method,
+                  knots, knotTangents);
+        // The first knot of a closed curve came back at the end, its
+        // tangent goes between the two fitted ones
+        if (curve.closed && knots.size() > 2) {
+            glm::vec2 t = knotTangents.front() + knotTangents.back();
+            if (glm::dot(t, t) > 0.0f) {
+                knotTangents.front() = glm::normalize(t);
+            }
+            knots.pop_back();
+            knotTangents.pop_back();
+        }
+        if (FollowsCurve(bvh, knots, knotTangents, curve.closed, error,
+                         spacing)) {
+            return;
+        }
+        tolerance *= 0.5;
+    }
+    knots.assign(points.begin() + curve.first,
+                 points.begin() + curve.first + curve.count);
+    knotTangents.assign(tangents.values.begin() + curve.first,
+                        tangents.values.begin() + curve.first + curve.count);
+}
+
+// FNV-1a over the points, tangents and closed flag of curve c
+uint64_t CurveHash(const std::vector<glm::dvec2>& points,
+                   const Tangents& tangents, TangentMethod method,
+                   const Curve& curve) {
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    if (curve.count > 0) {
+        add(&points[curve.first], curve.count * sizeof(points[0]));
+        add(&tangents.values[curve.first],
+            curve.count * sizeof(tangents.values[0]));
+    }
+    uint32_t flags = (curve.closed ? 1u : 0u) | uint32_t(method) << 1;
+    add(&flags, sizeof(flags));
+    return hash;
+}
+
+}  // namespace
+
+void LodHierarchy::init() {
+    pointBuffer.init();
+    curveBuffer.init();
+}
+
+void LodHierarchy::markChanged(double time) {
+    stale = true;
+    changeTime = time;
+}
+
+bool LodHierarchy::needsBuild(double time, double settleTime) const {
+    return stale && time - changeTime >= settleTime;
+}
+
+void LodHierarchy::build(const std::vector<glm::dvec2>& points,
+                         const Tangents& tangents, const CurveTable& curves) {
+    if (pixelError != fitError) {
+        fits.clear();
+        fitError = pixelError;
+    }
+    // Take the fits of the curves that didn't change, fit the others
+    std::map<uint64_t, CurveLevels> kept;
+    std::vector<const CurveLevels*> curveLevels(curves.curves.size());
+    int levelCount = 0;
+    refitCount = 0;
+    std::vector<Arc> arcs;
+    for (size_t c = 0; c < curves.curves.size(); ++c) {
+        const Curve& curve = curves.curves[c];
+        uint64_t key = CurveHash(points, tangents, tangents.method, curve);
+        std::map<uint64_t, CurveLevels>::iterator it = kept.find(key);
+        if (it == kept.end()) {
+            it = kept.insert(std::make_pair(key, CurveLevels())).first;
+            std::map<uint64_t, CurveLevels>::iterator old = fits.find(key);
+            if (old != fits.end()) {
+                it->second = std::move(old->second);
+            } else if (curve.count >= 3) {
+                fitLevels(points, tangents, curves, c, arcs, it->second);
+                ++refitCount;
+            }
+        }
+        curveLevels[c] = &it->second;
+        levelCount =
+            std::max(levelCount, static_cast<int>(it->second.points.size()));
+    }
+    fits.swap(kept);
+
+    // Each level takes the last level of the curves that stopped before it
+    levels.resize(levelCount);
+    for (int i = 1; i <= levelCount; ++i) {
+        LodLevel& level = levels[i - 1];
+        level.error = std::ldexp(pixelError, i - 1);
+        level.points.clear();
+        level.tangents.values.clear();
+        level.curves = curves;
+        for (size_t c = 0; c < curves.curves.size(); ++c) {
+            const Curve& curve = curves.curves[c];
+            Curve& fitted = level.curves.curves[c];
+            fitted.first = level.points.size();
+            const CurveLevels& fit = *curveLevels[c];
+            if (fit.points.empty()) {
+                level.points.insert(level.points.end(),
+                                    points.begin() + curve.first,
+                                    points.begin() + curve.first + curve.count);
+                level.tangents.values.insert(
+                    level.tangents.values.end(),
+                    tangents.values.begin() + curve.first,
+                    tangents.values.begin() + curve.first + curve.count);
+                continue;
+            }
+            size_t j = std::min(static_cast<size_t>(i), fit.points.size()) - 1;
+            fitted.count = fit.points[j].size();
+            level.points.insert(level.points.end(), fit.points[j].begin(),
+                                fit.points[j].end());
+            level.tangents.values.insert(level.tangents.values.end(),
+                                         fit.tangents[j].begin(),
+                                         fit.tangents[j].end());
+        }
+        level.tangents.pinned = level.tangents.values;
+        if (!level.points.empty()) {
+            level.curves.updateBounds(level.points, level.tangents.values, 0,
+                                      level.points.size() - 1);
+        }
+    }
+    stale = false;
+    uploaded = -1;
+}
+
+void LodHierarchy::fitLevels(const std::vector<glm::dvec2>& points,
+                             const Tangents& tangents,
+                             const CurveTable& curves, size_t c,
+                             std::vector<Arc>& arcs, CurveLevels& fit) const {
+    const Curve& curve = curves.curves[c];
+    size_t end = curve.first + curve.count;
+    size_t segmentEnd = curve.closed ? end : end - 1;
+    arcs.clear();
+    for (size_t i = curve.first; i < segmentEnd; ++i) {
+        Biarc biarc = curves.segmentBiarc(points, tangents.values, i);
+        arcs.push_back(biarc.a);
+        arcs.push_back(biarc.b);
+    }
+    ArcBvh bvh;
+    bvh.build(arcs);
+    glm::dvec2 lo, hi;
+    double size = bvh.bounds(lo, hi) ? glm::length(hi - lo) : 0.0;
+    // Levels stop once the curve is down to its fewest knots, or the error
+    // outgrows the curve and coarser levels would fit it the same way
+    size_t fewest = curve.closed ? 3 : 2;
+    for (int i = 1; i <= kMaxLevels; ++i) {
+        double error = std::ldexp(pixelError, i - 1);
+        std::vector<glm::dvec2> knots;
+        std::vector<glm::vec2> knotTangents;
+        FitCurve(points, tangents, curves, c, bvh, error, knots,
+                 knotTangents);
+        size_t count = knots.size();
+        fit.points.push_back(knots);
+        fit.tangents.push_back(knotTangents);
+        if (count <= fewest || error > size) {
+            break;
+        }
+    }
+}
+
+int LodHierarchy::select(double scale) const {
+    if (stale || levels.empty() || scale > 1.0) {
+        return 0;
+    }
+    // Level i is good for scales up to 2^-(i - 1)
+    int i = static_cast<int>(std::floor(-std::log2(scale))) + 1;
+    return std::min(i, static_cast<int>(levels.size()));
+}
+
+void LodHierarchy::upload(int i, bool compact) {
+    if (i == uploaded && compact == uploadedCompact) {
+        return;
+    }
+    const LodLevel& lod = level(i);
+    pointBuffer.compact = compact;
+    pointBuffer.rebuild(lod.points, lod.tangents);
+    curveBuffer.update(lod.curves);
+    arcLengths.markChanged(0, lod.points.size());
+    arcLengths.update(lod.points, lod.tangents.values, lod.curves);
+    curvePicker.update(arcLengths);
+    uploaded = i;
+    uploadedCompact = compact;
+}
+
+size_t LodHierarchy::gpuBytes() const {
+    return pointBuffer.gpuBytes() + curveBuffer.gpuBytes();
+}
+
+void LodHierarchy::cleanup() {
+    pointBuffer.cleanup();
+    curveBuffer.cleanup();
+}
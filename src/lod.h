@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <map>
+#include <vector>
+
+#include "arc_length.h"
+#include "biarc.h"
+#include "curve_buffer.h"
+#include "curve_pick.h"
+#include "curve_table.h"
+#include "point_buffer.h"
+#include "tangents.h"
+
+// Simplified copy of all curves, with the same curves in the same order
+struct LodLevel {
+    // World units the arcs of the full curves and the simplified ones may
+    // lie apart, up to the sampling of both
+    double error;
+    std::vector<glm::dvec2> points;
+    // Fitted tangents, all pinned
+    Tangents tangents;
+    CurveTable curves;
+};
+
+// Levels of detail for zoomed out views. Level i >= 1 refits every curve
+// with `FitBiarcs` to an error of pixelError * 2^(i - 1) world units, which
+// is pixelError window pixels at scale 2^-(i - 1), so the segments drawn
+// follow the detail that is visible rather than the number of points.
+// Level 0 is the full curves. Each level is fitted to dense samples of the
+// full curves, not to the level below, so the errors don't add up, and
+// the fitted arcs are checked against the full ones. A fit that strays is
+// redone with a smaller tolerance, and after a few tries the curve keeps
+// its full points at that level. A curve stops getting levels at its
+// fewest knots, and coarser levels reuse its last one.
+//
+// The hierarchy is rebuilt once the points settle after an edit. Until
+// then the full curves are drawn. A build keeps the fits of the curves
+// whose points and tangents didn't change, so only the edited curves are
+// refitted. Only the level in use has a GPU copy, uploaded when the zoom
+// crosses into another level.
+struct LodHierarchy {
+    static const int kMaxLevels = 24;
+
+    // Error of each level in window pixels at the largest scale it is
+    // drawn at
+    float pixelError = 0.25f;
+    // Time of the last build
+    double buildMs = 0.0;
+    // Curves the last build fitted rather than kept
+    size_t refitCount = 0;
+
+    PointBuffer pointBuffer;
+    CurveBuffer curveBuffer;
+    // Biarcs of the uploaded level, for culling its segments
+    ArcLengthTable arcLengths;
+    CurvePicker curvePicker;
+
+    void init();
+    // The curves changed at the given time, so the levels are stale
+    void markChanged(double time);
+    // Whether the levels are stale and the curves haven't changed for
+    // settleTime seconds
+    bool needsBuild(double time, double settleTime) const;
+    bool isStale() const { return stale; }
+    void build(const std::vector<glm::dvec2>& points,
+               const Tangents& tangents, const CurveTable& curves);
+    // Coarsest level within pixelError at the camera scale, 0 for the full
+    // curves
+    int select(double scale) const;
+    // Copy level i >= 1 to the buffers unless they hold it already
+    void upload(int i, bool compact);
+    const LodLevel& level(int i) const { return levels[i - 1]; }
+    // Levels including the full curves
+    int levelCount() const { return static_cast<int>(levels.size()) + 1; }
+    size_t gpuBytes() const;
+    void cleanup();
+
+   private:
+    // Fitted levels of one curve from level 1 on
+    struct CurveLevels {
+        std::vector<std::vector<glm::dvec2>> points;
+        std::vector<std::vector<glm::vec2>> tangents;
+    };
+
+    void fitLevels(const std::vector<glm::dvec2>& points,
+                   const Tangents& tangents, const CurveTable& curves,
+                   size_t c, std::vector<Arc>& arcs, CurveLevels& fit) const;
+
+    std::vector<LodLevel> levels;
+    // Fits of the curves at the last build by a hash of their points,
+    // tangents, closed flag and tangent method, for pixelError fitError
+    std::map<uint64_t, CurveLevels> fits;
+    float fitError = 0.0f;
+    bool stale = true;
+    double changeTime = 0.0;
+    // Level the buffers hold, or -1
+    int uploaded = -1;
+    bool uploadedCompact = false;
+};
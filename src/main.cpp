@@ -8,13 +8,38 @@
 #include <imgui.h>
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <numeric>
+#include <string>
 #include <vector>
 
+#include "arc_length.h"
+#include "biarc.h"
+#include "camera.h"
+#include "crossings.h"
+#include "cursor_capture.h"
+#include "curve_buffer.h"
+#include "curve_pick.h"
+#include "curve_table.h"
+#include "gcode_export.h"
+#include "jump_flood.h"
+#include "lod.h"
+#include "offset.h"
+#include "point_buffer.h"
+#include "point_file.h"
+#include "point_stream.h"
+#include "stroke_renderer.h"
+#include "shader.h"
+#include "simplify.h"
+#include "svg_import.h"
+#include "tangents.h"
+#include "tile_pyramid.h"
+
 // Shader source code
 const char* vertexShaderSource = R"(
     #version 330 core
@@ -25,17 +50,49 @@ const char* vertexShaderSource = R"(
     }
 )";
 
-const char* fragmentShaderSource = R"(
+// Code shared by all fragment shaders, which come together as the header,
+// kViewSource, kPointFetchSource, kCurveTableSource, the common code and the
+// main() of each pass.
+const char* shaderHeaderSource = R"(
     #version 330 core
     layout(origin_upper_left) in vec4 gl_FragCoord;
-    out vec4 fragColor;
-    
+)";
+
+const char* shaderCommonSource = R"(
     uniform vec2 mousePos;
     uniform vec2 windowSize;
 
     uniform int nearestIndex;
     uniform int pointCount;
-    uniform samplerBuffer pointsTexture;  // TBO for point data
+
+    // Per-column crossing table, replaces the per-arc even-odd test
+    uniform bool useScanlineSign;
+    uniform isamplerBuffer crossingOffsets;
+    uniform samplerBuffer crossingValues;
+
+    // Edge length in pixels of the tiles of the coarse pass
+    uniform int tileSize;
+    // Resolution of the render target relative to the window
+    uniform float renderScale;
+    // Whether all curves are closed, so that the coarse pass can find the
+    // even-odd sign of every tile once and the pixels only add the
+    // crossings of their candidates
+    uniform bool tileFill;
+    // Curve of the dynamic layer, or -1 to draw all curves in one pass. The
+    // static layer is every other curve.
+    uniform int layerCurve;
+    uniform bool dynamicLayer;
+
+    // Flag in the count of a tile for an odd number of crossings at its
+    // reference point, and in the candidates for closing segments
+    const int TILE_ODD = 0x100;
+    const int CLOSING_SEGMENT = 0x40000000;
+    // Reference point of the tile sign relative to the tile center, off
+    // the pixel centers and the integer positions of placed points
+    const vec2 TILE_REFERENCE = vec2(0.25, 0.375);
+
+    // Whether the SDFs accumulate the even-odd sign, set by each main()
+    bool signFromArcs = true;
 
     float DigitBin(const in int x) {
         return x == 0   ? 480599.0
@@ -139,7 +196,7 @@ const char* fragmentShaderSource = R"(
         float d = length(p - e * h);
         float s = 1.0;
         // even-odd rule
-        if ((p.x > 0.0) != (p.x > e.x)) {
+        if (signFromArcs && (p.x > 0.0) != (p.x > e.x)) {
             if ((e.x * p.y < e.y * p.x) != (e.x < 0.0)) {
                 s = -s;
             } 
@@ -261,7 +318,7 @@ const char* fragmentShaderSource = R"(
         float cos_opening_angle = dot(n, p);
         float s = 1.0;
         float y_on_circle = r2 - x.x * x.x;
-        if (y_on_circle >= 0.0) {
+        if (signFromArcs && y_on_circle >= 0.0) {
             // This implies abs(x.x) < r.
             y_on_circle = sqrt(y_on_circle);
             // Check if line drawn straight from x to infinity
@@ -287,7 +344,28 @@ const char* fragmentShaderSource = R"(
         return sqrt(min(dot(xa, xa), dot(xb, xb))) * s;
     }
 
-    void biarc_sdf(vec2 p0, vec2 t0, vec2 p1, vec2 t1, inout float s, inout float d) {
+    // Even-odd sign from the number of crossings below x in its column,
+    // found by binary search over the sorted crossings.
+    float scanline_sign(vec2 x) {
+        int col = int(x.x);
+        if (col < 0 || col + 1 >= textureSize(crossingOffsets)) {
+            return 1.0;
+        }
+        int lo = texelFetch(crossingOffsets, col).x;
+        int end = texelFetch(crossingOffsets, col + 1).x;
+        int hi = end;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (texelFetch(crossingValues, mid).x > x.y) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        return ((end - lo) & 1) == 0 ? 1.0 : -1.0;
+    }
+
+    void biarc_sdf(vec2 p0, vec2 t0, vec2 p1, vec2 t1, vec2 x, inout float s, inout float d) {
         // chord given by points on circle
         vec2 chord = p0 - p1;
         // vector along which center must lie
@@ -304,67 +382,446 @@ const char* fragmentShaderSource = R"(
         vec2 t = c + sign(cro(p0_c, chord)) * sqrt(r2) * r / length(r);
 
         // Find arcs and evaluate SDF in one go
-        float sd1 = circle_arc_sdf(p0, t, t0, gl_FragCoord.xy);
+        float sd1 = circle_arc_sdf(p0, t, t0, x);
         d = min(d, abs(sd1));
         s *= sign(sd1);
-        float sd2 = circle_arc_sdf(p1, t, -t1, gl_FragCoord.xy);
+        float sd2 = circle_arc_sdf(p1, t, -t1, x);
         d = min(d, abs(sd2));
         s *= sign(sd2);
     }
 
+    // End points and unit tangents of the biarc between points i and i + 1
+    void segment(int i, out vec2 p0, out vec2 t0, out vec2 p1, out vec2 t1) {
+        vec4 point0 = fetch_point(i);
+        vec4 point1 = fetch_point(i + 1);
+        p0 = point0.xy;
+        t0 = point0.zw;
+        p1 = point1.xy;
+        t1 = point1.zw;
+    }
+
+    // Segment i of a curve entry, where the last point of a closed curve
+    // starts the closing segment back to its first point
+    void curve_segment(ivec3 curve, int i, out vec2 p0, out vec2 t0,
+                       out vec2 p1, out vec2 t1) {
+        vec4 point0 = fetch_point(i);
+        vec4 point1 = fetch_point(i + 1 < curve.x + curve.y ? i + 1 : curve.x);
+        p0 = point0.xy;
+        t0 = point0.zw;
+        p1 = point1.xy;
+        t1 = point1.zw;
+    }
+
+    // Segment of a tile candidate, only closing segments need their curve
+    void candidate_segment(int candidate, out vec2 p0, out vec2 t0,
+                           out vec2 p1, out vec2 t1) {
+        int i = candidate & ~CLOSING_SEGMENT;
+        if ((candidate & CLOSING_SEGMENT) != 0) {
+            curve_segment(texelFetch(curveTable, curve_at(i)).xyz, i, p0, t0,
+                          p1, t1);
+        } else {
+            segment(i, p0, t0, p1, t1);
+        }
+    }
+
+    bool curve_in_layer(int c) {
+        return layerCurve < 0 || (c == layerCurve) == dynamicLayer;
+    }
+
+    float curve_box_distance(int c, vec2 x) {
+        vec4 box = curve_box(c);
+        return length(max(max(box.xy - x, x - box.zw), 0.0));
+    }
+
+    // Whether the even-odd ray from x towards +y misses the box of curve c
+    bool curve_ray_missed(int c, vec2 x) {
+        vec4 box = curve_box(c);
+        return x.x < box.x || x.x > box.z || x.y > box.w;
+    }
+
+    // Whether no biarc of curve c can come closer to x than d, nor cross
+    // the even-odd ray from x
+    bool curve_culled(int c, vec2 x, float d) {
+        return curve_box_distance(c, x) >= d &&
+               (!signFromArcs || curve_ray_missed(c, x));
+    }
+
+    // Whether p lies between the columns of a and b and beyond the line
+    // from a to b in the direction of the even-odd ray. The rays from a
+    // and b and the line bound the region, so an open chain of biarcs
+    // crosses the three an odd number of times iff one of its ends lies
+    // in there.
+    bool beyond_path(vec2 p, vec2 a, vec2 b) {
+        if ((p.x > a.x) == (p.x > b.x)) {
+            return false;
+        }
+        return p.y > a.y + (b.y - a.y) * (p.x - a.x) / (b.x - a.x);
+    }
+)";
+
+// Final pass, shades every pixel
+const char* fragmentShaderSource = R"(
+    out vec4 fragColor;
+
+    uniform bool useTileCandidates;
+    uniform isampler2DArray tileCandidates;
+
+    // Nearest seed per texel from the jump flood engine
+    uniform bool useJumpFlood;
+    uniform bool refineJumpFlood;
+    uniform sampler2D jumpFlood;
+
+    // Distance, sign, nearest curve and point coverage of the static layer,
+    // which the dynamic layer combines with its own
+    uniform sampler2D staticLayer;
+
+    // Width of the band around the curve in which the analytic SDF refines
+    // the jump flood distance
+    const float REFINE_BAND = 8.0;
+
+    // The coarse pass sees gl_FragCoord with upper left origin, too, but
+    // texel rows are counted from the bottom.
+    ivec3 tile_texel(ivec2 tile, int layer) {
+        int rows = textureSize(tileCandidates, 0).y;
+        return ivec3(tile.x, rows - 1 - tile.y, layer);
+    }
+
+    // Index of the k-th candidate segment of a tile. Slot 0 holds the count.
+    int tile_candidate(ivec2 tile, int k) {
+        int slot = k + 1;
+        return texelFetch(tileCandidates, tile_texel(tile, slot / 4), 0)[slot % 4];
+    }
+
+    vec4 point_color(bool nearest) {
+        return vec4(nearest ? vec3(1.0, 0.5, 0.5) : vec3(1.0, 0.0, 0.0), 1.0);
+    }
+
+    void draw_point(int i, vec2 x) {
+        vec2 point = fetch_point(i).xy;
+        float distance = length(x - point);
+        if (distance <= (i == nearestIndex ? 8.0 : 5.0)) {
+            fragColor = point_color(i == nearestIndex);
+        }
+    }
+
     void main() {
         fragColor = vec4(0.0);
+        signFromArcs = !useScanlineSign;
+        vec2 x = gl_FragCoord.xy / renderScale;
+
+        // Candidate list of this tile, or -1 to evaluate every segment
+        ivec2 tile = ivec2(x) / tileSize;
+        int candidateCount = -1;
+        bool tileOdd = false;
+        if (useTileCandidates && !useJumpFlood && pointCount > 1) {
+            int header = texelFetch(tileCandidates, tile_texel(tile, 0), 0).x;
+            candidateCount = header < 0 ? -1 : header & ~TILE_ODD;
+            tileOdd = header >= 0 && (header & TILE_ODD) != 0;
+        }
+        // The sign of a closed fill is the tile's sign at its reference
+        // point, flipped by the crossings of the candidates on the way to x
+        bool fillFromTile =
+            tileFill && candidateCount >= 0 && !useScanlineSign;
+        vec2 reference = (vec2(tile) + 0.5) * float(tileSize) + TILE_REFERENCE;
+
+        // Segment nearest to the jump flood seed or among the candidates,
+        // or -1, and the curve nearest to x
+        int nearestSegment = -1;
+        int nearestCurve = -1;
 
         // biarc
         float d = float(0xffffffffU);
         float s = 1.0;
-        for(int i = 0; i < pointCount - 1; ++i) {
-            vec2 p0 = texelFetch(pointsTexture, i).xy;
-            vec2 p1 = texelFetch(pointsTexture, i + 1).xy;
+        vec2 p0, t0, p1, t1;
+        if (useJumpFlood) {
+            ivec2 size = textureSize(jumpFlood, 0);
+            vec4 seed = texelFetch(
+                jumpFlood, ivec2(int(x.x), size.y - 1 - int(x.y)), 0);
+            if (seed.w > 0.0) {
+                d = distance(x, vec2(seed.x, float(size.y) - seed.y));
+                nearestSegment = int(seed.z);
+            }
+            // Exact distance to the seed's segment and its neighbors on the
+            // same curve, around the seam of a closed one. The seed may
+            // also lie on the empty segment between two curves.
+            if (refineJumpFlood && nearestSegment >= 0 && d < REFINE_BAND) {
+                d = float(0xffffffffU);
+                int c = curve_at(nearestSegment);
+                ivec3 curve = texelFetch(curveTable, c).xyz;
+                int segments = curve_segment_count(curve);
+                bool closed = (curve.z & CURVE_CLOSED) != 0;
+                for (int k = -1; k <= 1 && segments > 0; ++k) {
+                    int i = nearestSegment + k - curve.x;
+                    if (closed) {
+                        i = (i + segments) % segments;
+                    }
+                    if (i < 0 || i >= segments) {
+                        continue;
+                    }
+                    curve_segment(curve, curve.x + i, p0, t0, p1, t1);
+                    biarc_sdf(p0, t0, p1, t1, x, s, d);
+                }
+            }
+        } else if (candidateCount >= 0) {
+            for (int k = 0; k < candidateCount; ++k) {
+                int candidate = tile_candidate(tile, k);
+                float previous = d;
+                candidate_segment(candidate, p0, t0, p1, t1);
+                biarc_sdf(p0, t0, p1, t1, x, s, d);
+                if (d < previous) {
+                    nearestSegment = candidate & ~CLOSING_SEGMENT;
+                }
+                if (fillFromTile &&
+                    beyond_path(p0, reference, x) !=
+                        beyond_path(p1, reference, x)) {
+                    s = -s;
+                }
+            }
+            if (fillFromTile && tileOdd) {
+                s = -s;
+            }
+        } else {
+            for (int k = 0; k < visibleRunCount; ++k) {
+                ivec3 run = visible_run(k);
+                int c = run.x;
+                if (!curve_in_layer(c) || curve_culled(c, x, d)) {
+                    continue;
+                }
+                float previous = d;
+                ivec3 curve = texelFetch(curveTable, c).xyz;
+                for (int i = run.y; i < run.z; ++i) {
+                    curve_segment(curve, i, p0, t0, p1, t1);
+                    biarc_sdf(p0, t0, p1, t1, x, s, d);
+                }
+                if (d < previous) {
+                    nearestCurve = c;
+                }
+            }
+        }
+        if (useScanlineSign) {
+            s = scanline_sign(x);
+        }
+        if (nearestSegment >= 0) {
+            nearestCurve = curve_at(nearestSegment);
+        }
 
-            vec2 pm1 = texelFetch(pointsTexture, max(i - 1, 0)).xy;
-            vec2 p2 = texelFetch(pointsTexture, min(pointCount - 1, i + 2)).xy;
-            vec2 t0 = p1 - pm1;
-            vec2 t1 = p2 - p0;
-            if (abs(t0.y) > 100.0) {
-                t0.y = sign(t0.y) * 100.0;
+        // The even-odd sign over all curves is the product of the signs of
+        // the layers, and the distance the smaller of theirs, which is what
+        // one pass over all curves finds
+        bool staticPoint = false;
+        if (layerCurve >= 0 && dynamicLayer) {
+            ivec2 texel = ivec2(gl_FragCoord.xy);
+            texel.y = textureSize(staticLayer, 0).y - 1 - texel.y;
+            vec4 layer = texelFetch(staticLayer, texel, 0);
+            if (layer.x < d) {
+                d = layer.x;
+                nearestCurve = int(layer.z);
             }
-            if (abs(t1.y) > 100.0) {
-                t1.y = sign(t1.y) * 100.0;
+            s *= layer.y;
+            staticPoint = layer.w > 0.0;
+        }
+
+        // Draw curve in the color of the nearest one
+        if (fragColor.a == 0.0) {
+            vec3 color =
+                nearestCurve >= 0 ? curve_color(nearestCurve) : vec3(1.0);
+            float coverage = 1.0 - smoothstep(-5.0, 5.0, s * d);
+            fragColor = vec4(color * coverage, coverage);
+        }
+        if (staticPoint) {
+            fragColor = point_color(false);
+        }
+        // The static layer only notes where its points are
+        bool staticPass = layerCurve >= 0 && !dynamicLayer;
+        if (staticPass) {
+            fragColor = vec4(0.0);
+        }
+
+        if (useJumpFlood) {
+            // Points of the nearest segments. Without any seed this still
+            // covers a single point.
+            int last = min(nearestSegment + 2, pointCount - 1);
+            for (int i = max(nearestSegment - 1, 0); i <= last; ++i) {
+                draw_point(i, x);
+            }
+        } else if (candidateCount >= 0) {
+            for (int k = 0; k < candidateCount; ++k) {
+                int candidate = tile_candidate(tile, k);
+                int i = candidate & ~CLOSING_SEGMENT;
+                draw_point(i, x);
+                if ((candidate & CLOSING_SEGMENT) == 0) {
+                    draw_point(i + 1, x);
+                }
+            }
+        } else {
+            for (int k = 0; k < visibleRunCount; ++k) {
+                ivec3 run = visible_run(k);
+                int c = run.x;
+                if (!curve_in_layer(c) || curve_box_distance(c, x) > 8.0) {
+                    continue;
+                }
+                // The end point of the run, unless it closes the curve
+                ivec2 curve = texelFetch(curveTable, c).xy;
+                int last = min(run.z, curve.x + curve.y - 1);
+                for (int i = run.y; i <= last; ++i) {
+                    draw_point(i, x);
+                }
             }
+        }
+        // The highlight goes to the dynamic layer, wherever its point is
+        if (layerCurve >= 0 && dynamicLayer && nearestIndex >= 0) {
+            draw_point(nearestIndex, x);
+        }
+        if (staticPass) {
+            fragColor = vec4(d, s, float(nearestCurve), fragColor.a);
+        }
+    }
+)";
+
+// Offset curves drawn over the curve, with their knots in a point buffer of
+// their own. A knot with a zero tangent separates two curves.
+const char* offsetShaderSource = R"(
+    out vec4 fragColor;
 
-            t0 = t0 / length(t0);
-            t1 = t1 / length(t1);
+    const vec3 OFFSET_COLOR = vec3(0.2, 0.6, 1.0);
 
-            biarc_sdf(p0, t0, p1, t1, s, d);         
+    void main() {
+        signFromArcs = false;
+        vec2 x = gl_FragCoord.xy;
+        float s = 1.0;
+        float d = float(0xffffffffU);
+        vec2 p0, t0, p1, t1;
+        for (int i = 0; i < pointCount - 1; ++i) {
+            segment(i, p0, t0, p1, t1);
+            if (t0 == vec2(0.0) || t1 == vec2(0.0)) {
+                continue;
+            }
+            biarc_sdf(p0, t0, p1, t1, x, s, d);
         }
+        fragColor = vec4(OFFSET_COLOR, 1.0 - smoothstep(0.5, 1.5, d));
+    }
+)";
 
-        // Draw curve
-        if (fragColor.a == 0.0) {
-            fragColor.rgb = vec3(1.0 - smoothstep(-5.0, 5.0, s * d));
+// Coarse pass, one fragment per tile. Collects the segments that can be
+// closest to some pixel of the tile. Distances are 1-Lipschitz, so within
+// the tile they are bounded by the distance at its center +- half diagonal.
+// If all curves are closed, it also counts the crossings of the even-odd ray
+// from the tile's reference point. Crossings of a closed curve only change
+// where the curve passes between the reference point and the pixel, which
+// it can only do through the tile, i.e. through the candidates.
+const char* coarseShaderSource = R"(
+    layout(location = 0) out ivec4 candidates0;
+    layout(location = 1) out ivec4 candidates1;
+    layout(location = 2) out ivec4 candidates2;
+    layout(location = 3) out ivec4 candidates3;
+
+    const int MAX_CANDIDATES = 15;
+    // Largest control point radius, AA only needs the closest segment
+    const float BAND = 8.0;
+
+    void main() {
+        // The sign at the reference point comes along with the distances
+        signFromArcs = tileFill;
+        vec2 center = (floor(gl_FragCoord.xy) + 0.5) * float(tileSize) +
+                      TILE_REFERENCE;
+        float halfDiagonal =
+            0.70710678 * float(tileSize) + length(TILE_REFERENCE);
+
+        int candidates[MAX_CANDIDATES];
+        float lowerBounds[MAX_CANDIDATES];
+        int count = 0;
+        float minUpperBound = float(0xffffffffU);
+        float tileSign = 1.0;
+        vec2 p0, t0, p1, t1;
+        for (int v = 0; v < visibleRunCount && count >= 0; ++v) {
+            ivec3 run = visible_run(v);
+            int c = run.x;
+            if (!curve_in_layer(c)) {
+                continue;
+            }
+            // The whole curve lies too far away, and for the sign also off
+            // the even-odd ray
+            bool far = curve_box_distance(c, center) - halfDiagonal >
+                       minUpperBound + BAND;
+            if (far && (!tileFill || curve_ray_missed(c, center))) {
+                continue;
+            }
+            ivec3 curve = texelFetch(curveTable, c).xyz;
+            for (int i = run.y; i < run.z; ++i) {
+                float s = 1.0;
+                float d = float(0xffffffffU);
+                curve_segment(curve, i, p0, t0, p1, t1);
+                biarc_sdf(p0, t0, p1, t1, center, s, d);
+                tileSign *= s;
+                minUpperBound = min(minUpperBound, d + halfDiagonal);
+                float threshold = minUpperBound + BAND;
+                if (far || d - halfDiagonal > threshold) {
+                    continue;
+                }
+                if (count == MAX_CANDIDATES) {
+                    // Drop candidates which got beaten since they were added
+                    int kept = 0;
+                    for (int k = 0; k < MAX_CANDIDATES; ++k) {
+                        if (lowerBounds[k] <= threshold) {
+                            candidates[kept] = candidates[k];
+                            lowerBounds[kept] = lowerBounds[k];
+                            ++kept;
+                        }
+                    }
+                    // Overflow, the final pass falls back to all segments
+                    count = kept < MAX_CANDIDATES ? kept : -1;
+                    if (count < 0) {
+                        break;
+                    }
+                }
+                candidates[count] =
+                    i + 1 == curve.x + curve.y ? i | CLOSING_SEGMENT : i;
+                lowerBounds[count] = d - halfDiagonal;
+                ++count;
+            }
         }
 
-        for (int i = 0; i < pointCount; ++i) {
-            vec2 point = texelFetch(pointsTexture, i).xy;
-            float distance = length(gl_FragCoord.xy - point);
-            if (distance <= (i == nearestIndex ? 8.0 : 5.0)) {
-                fragColor = vec4(
-                    i == nearestIndex ? vec3(1.0, 0.5, 0.5) : vec3(1.0, 0.0, 0.0),
-                    1.0);
+        // Final pruning against the overall minimum
+        if (count > 0) {
+            int kept = 0;
+            for (int k = 0; k < count; ++k) {
+                if (lowerBounds[k] <= minUpperBound + BAND) {
+                    candidates[kept++] = candidates[k];
+                }
+            }
+            count = kept;
+        }
+        for (int k = max(count, 0); k < MAX_CANDIDATES; ++k) {
+            candidates[k] = 0;
+        }
+
+        // The pixels add the crossings of the candidates themselves, so
+        // take them out of the tile's sign
+        int header = count;
+        if (tileFill && count >= 0) {
+            float d = float(0xffffffffU);
+            for (int k = 0; k < count; ++k) {
+                candidate_segment(candidates[k], p0, t0, p1, t1);
+                biarc_sdf(p0, t0, p1, t1, center, tileSign, d);
             }
+            header |= tileSign < 0.0 ? TILE_ODD : 0;
         }
+
+        candidates0 = ivec4(header, candidates[0], candidates[1], candidates[2]);
+        candidates1 = ivec4(candidates[3], candidates[4], candidates[5], candidates[6]);
+        candidates2 = ivec4(candidates[7], candidates[8], candidates[9], candidates[10]);
+        candidates3 = ivec4(candidates[11], candidates[12], candidates[13], candidates[14]);
     }
 )";
 
 // Function to find the index of the nearest point to a given position
-int FindNearestPoint(const glm::vec2& position,
-                     const std::vector<glm::vec2>& points,
-                     float threshold = 50.0f) {
-    float minDistance = threshold;
+int FindNearestPoint(const glm::dvec2& position,
+                     const std::vector<glm::dvec2>& points, double threshold) {
+    double minDistance = threshold;
     int nearestIndex = -1;
 
     for (size_t i = 0; i < points.size(); ++i) {
-        float distance = glm::distance(position, points[i]);
+        double distance = glm::distance(position, points[i]);
         if (distance < minDistance) {
             minDistance = distance;
             nearestIndex = static_cast<int>(i);
@@ -374,6 +831,338 @@ int FindNearestPoint(const glm::vec2& position,
     return nearestIndex;
 }
 
+// Compile the full-screen quad vertex shader and a fragment shader made of
+// the common code and the given main
+GLuint CreateShaderProgram(const char* fragmentMainSource) {
+    const char* fragmentSources[] = {shaderHeaderSource, kViewSource,
+                                     kPointFetchSource, kCurveTableSource,
+                                     shaderCommonSource, fragmentMainSource};
+    return CreateProgram(vertexShaderSource, fragmentSources, 6);
+}
+
+// Render target of the coarse pass: one texel per tile, holding the
+// candidate count with the tile's fill sign and up to 15 segment indices in
+// four RGBA32I layers.
+struct TileCandidates {
+    static const int kTileSize = 8;
+    static const int kLayers = 4;
+
+    GLuint fbo, texture;
+    int tilesX = 0, tilesY = 0;
+
+    void init() {
+        glGenFramebuffers(1, &fbo);
+        glGenTextures(1, &texture);
+    }
+
+    // (Re-)allocate the layers for the given framebuffer size
+    void resize(int width, int height) {
+        int newTilesX = (width + kTileSize - 1) / kTileSize;
+        int newTilesY = (height + kTileSize - 1) / kTileSize;
+        if (newTilesX == tilesX && newTilesY == tilesY) {
+            return;
+        }
+        tilesX = newTilesX;
+        tilesY = newTilesY;
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA32I, tilesX, tilesY,
+                     kLayers, 0, GL_RGBA_INTEGER, GL_INT, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                        GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER,
+                        GL_NEAREST);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        GLenum drawBuffers[kLayers];
+        for (int i = 0; i < kLayers; ++i) {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i,
+                                      texture, 0, i);
+            drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+        }
+        glDrawBuffers(kLayers, drawBuffers);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) !=
+            GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Tile candidate framebuffer incomplete" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void cleanup() {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteTextures(1, &texture);
+    }
+};
+
+// Reduced resolution render target for the curve pass, upsampled to the
+// window with a linear blit. The texture has the size of the window, and
+// the pass draws into its lower left width x height texels, so the smoothly
+// changing scale never reallocates it.
+struct ScaledTarget {
+    GLuint fbo, texture;
+    int width = 0, height = 0;
+    // Size of the texture
+    int textureWidth = 0, textureHeight = 0;
+
+    void init() {
+        glGenFramebuffers(1, &fbo);
+        glGenTextures(1, &texture);
+    }
+
+    void resize(int windowWidth, int windowHeight, float scale) {
+        width = std::max(1, static_cast<int>(windowWidth * scale));
+        height = std::max(1, static_cast<int>(windowHeight * scale));
+        if (windowWidth == textureWidth && windowHeight == textureHeight) {
+            return;
+        }
+        textureWidth = windowWidth;
+        textureHeight = windowHeight;
+
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, textureWidth, textureHeight,
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, texture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) !=
+            GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Scaled framebuffer incomplete" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void blitToWindow(int windowWidth, int windowHeight) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, windowWidth,
+                          windowHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void cleanup() {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteTextures(1, &texture);
+    }
+};
+
+// Full resolution field of the static layer, every curve but the one being
+// edited: the distance, the even-odd sign and the nearest curve of each
+// pixel, and whether a point covers it, as RGBA32F. It is only redrawn when
+// it goes stale. The dynamic layer reads it every frame and combines it
+// with its own curve, which gives the same pixels as one pass over all
+// curves, so an edit costs the same however many curves lie around it.
+struct LayerCache {
+    GLuint fbo, texture;
+    int width = 0, height = 0;
+    // Curve left out of the image, the curve count and the pass settings it
+    // was drawn with
+    int dynamicCurve = -1;
+    size_t curveCount = 0;
+    int mode = 0;
+    bool valid = false;
+
+    void init() {
+        glGenFramebuffers(1, &fbo);
+        glGenTextures(1, &texture);
+    }
+
+    // Whether the image still shows the static layer around curve
+    bool matches(int newWidth, int newHeight, int curve, size_t count,
+                 int newMode) const {
+        return valid && newWidth == width && newHeight == height &&
+               curve == dynamicCurve && count == curveCount &&
+               newMode == mode;
+    }
+
+    // Bind the framebuffer to draw the static layer around curve into
+    void begin(int newWidth, int newHeight, int curve, size_t count,
+               int newMode) {
+        if (newWidth != width || newHeight != height) {
+            width = newWidth;
+            height = newHeight;
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0,
+                         GL_RGBA, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                   GL_TEXTURE_2D, texture, 0);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) !=
+                GL_FRAMEBUFFER_COMPLETE) {
+                std::cerr << "Layer framebuffer incomplete" << std::endl;
+            }
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, width, height);
+        dynamicCurve = curve;
+        curveCount = count;
+        mode = newMode;
+        valid = true;
+    }
+
+    void cleanup() {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteTextures(1, &texture);
+    }
+};
+
+// Picks the resolution of the curve pass during interactions so that its GPU
+// time stays within a budget. Timings come from a ring of timer queries,
+// which are only read back once available to avoid stalling the pipeline.
+struct RenderScaleController {
+    static const int kQueries = 4;
+
+    GLuint queries[kQueries];
+    bool pending[kQueries] = {};
+    float queryScales[kQueries];
+    int current = 0;
+    bool measuring = false;
+
+    float budgetMs = 8.0f;
+    float minScale = 0.25f;
+    float scale = 1.0f;
+    // Last measured GPU time, and extrapolated to full resolution
+    float gpuMs = 0.0f;
+    float fullResMs = 0.0f;
+
+    void init() { glGenQueries(kQueries, queries); }
+
+    void beginPass() {
+        // Skip the measurement if the slot's last result is still in flight
+        measuring = !pending[current];
+        if (measuring) {
+            queryScales[current] = scale;
+            glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+        }
+    }
+
+    void endPass() {
+        if (measuring) {
+            glEndQuery(GL_TIME_ELAPSED);
+            pending[current] = true;
+        }
+        current = (current + 1) % kQueries;
+    }
+
+    // Collect finished queries and choose the scale of the next frame
+    void update(bool interacting) {
+        for (int i = 0; i < kQueries; ++i) {
+            if (!pending[i]) {
+                continue;
+            }
+            GLint available = 0;
+            glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE,
+                               &available);
+            if (!available) {
+                continue;
+            }
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &ns);
+            pending[i] = false;
+            gpuMs = static_cast<float>(ns) * 1.e-6f;
+            // Cost is roughly proportional to the number of pixels
+            fullResMs = gpuMs / (queryScales[i] * queryScales[i]);
+        }
+
+        if (!interacting || fullResMs <= 0.0f) {
+            scale = 1.0f;
+            return;
+        }
+        float target = std::sqrt(budgetMs / fullResMs);
+        target = std::min(1.0f, std::max(minScale, target));
+        // Smooth out jitter of the measurements
+        scale = 0.5f * (scale + target);
+    }
+
+    void cleanup() { glDeleteQueries(kQueries, queries); }
+};
+
+// Time from the input event a frame shows until the GPU finished the frame.
+// A timestamp query right before the swap marks the GPU completion, which is
+// mapped to glfwGetTime() through the GPU clock at submission. Scan-out and
+// compositing come on top and are not measured.
+struct LatencyMonitor {
+    static const int kQueries = 8;
+    static const size_t kMaxSamples = 512;
+
+    GLuint queries[kQueries];
+    bool pending[kQueries] = {};
+    double inputTimes[kQueries];
+    // CPU and GPU clocks at submission
+    double submitTimes[kQueries];
+    GLint64 submitGpuTimes[kQueries];
+    int current = 0;
+
+    // Latencies in ms, a ring of the most recent frames
+    std::vector<double> samples;
+    size_t nextSample = 0;
+
+    void init() { glGenQueries(kQueries, queries); }
+
+    // Call right before the swap with the time of the input event the frame
+    // shows, or a negative time if it shows none
+    void submit(double inputTime) {
+        if (inputTime < 0.0 || pending[current]) {
+            return;
+        }
+        glQueryCounter(queries[current], GL_TIMESTAMP);
+        glGetInteger64v(GL_TIMESTAMP, &submitGpuTimes[current]);
+        submitTimes[current] = glfwGetTime();
+        inputTimes[current] = inputTime;
+        pending[current] = true;
+        current = (current + 1) % kQueries;
+    }
+
+    // Collect the frames the GPU finished
+    void update() {
+        for (int i = 0; i < kQueries; ++i) {
+            if (!pending[i]) {
+                continue;
+            }
+            GLint available = 0;
+            glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE,
+                               &available);
+            if (!available) {
+                continue;
+            }
+            GLuint64 gpuDone = 0;
+            glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &gpuDone);
+            pending[i] = false;
+            double done =
+                submitTimes[i] +
+                static_cast<double>(static_cast<GLint64>(gpuDone) -
+                                    submitGpuTimes[i]) *
+                    1.e-9;
+            double ms = (std::max(done, submitTimes[i]) - inputTimes[i]) * 1.e3;
+            if (samples.size() < kMaxSamples) {
+                samples.push_back(ms);
+            } else {
+                samples[nextSample] = ms;
+            }
+            nextSample = (nextSample + 1) % kMaxSamples;
+        }
+    }
+
+    // Latency in ms below which the fraction p of the samples lie
+    double percentile(double p) const {
+        if (samples.empty()) {
+            return 0.0;
+        }
+        std::vector<double> sorted = samples;
+        size_t k = std::min(sorted.size() - 1,
+                            static_cast<size_t>(p * sorted.size()));
+        std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+        return sorted[k];
+    }
+
+    void cleanup() { glDeleteQueries(kQueries, queries); }
+};
+
 struct App {
     GLFWwindow* window;
     int width = 1200, height = 675;
@@ -382,6 +1171,10 @@ struct App {
     // Used for drawing full-screen quad
     GLuint VBO, VAO;
 
+    // Every cursor event since the last frame
+    CursorCapture cursor;
+    LatencyMonitor latency;
+
     int init() {
         if (!glfwInit()) {
             std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -402,6 +1195,8 @@ struct App {
 
         glfwSetWindowUserPointer(window, this);
         glfwSetFramebufferSizeCallback(window, &App::FramebufferSizeCallback);
+        // Set before ImGui installs its callbacks, which chain to this one
+        glfwSetCursorPosCallback(window, &App::CursorPosCallback);
 
         // Vsync
         glfwSwapInterval(1);
@@ -444,17 +1239,24 @@ struct App {
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
 
+        latency.init();
+
         return 0;
     }
 
-    void draw() {
-        // Draw a full-screen quad
+    void drawFullscreenQuad() {
         glBindVertexArray(VAO);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
 
+    // Finish the frame after the curve pass has been drawn. inputTime is the
+    // time of the input event the frame shows, or negative if there is none.
+    void draw(double inputTime) {
         // Render ImGui
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+        latency.update();
+        latency.submit(inputTime);
         glfwSwapBuffers(window);
     }
 
@@ -462,6 +1264,7 @@ struct App {
         ImGui_ImplOpenGL3_Shutdown();
         ImGui_ImplGlfw_Shutdown();
         ImGui::DestroyContext();
+        latency.cleanup();
         glDeleteBuffers(1, &VBO);
         glDeleteVertexArrays(1, &VAO);
         glfwTerminate();
@@ -488,80 +1291,387 @@ struct App {
         App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
         app->framebufferSizeCallback(width, height);
     }
+
+    static void CursorPosCallback(GLFWwindow* window, double x, double y) {
+        App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
+        CursorEvent event;
+        event.position = glm::dvec2(x, y);
+        event.time = glfwGetTime();
+        event.pressed =
+            glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+        app->cursor.record(event);
+    }
 };
 
-int main() {
+// Most streamed points appended per frame, which bounds the time of the
+// incremental updates
+const size_t kMaxStreamBatch = 1 << 18;
+// Beyond this many points the index labels are left out
+const size_t kMaxAnnotatedPoints = 1000;
+// Clicks at most this far from the curve insert a point into it
+const double kInsertDistance = 8.0;
+// Picks at most this far from a knot land on the knot instead, in pixels
+const double kKnotSnapDistance = 3.0;
+// Points at most this far from the cursor can be moved, in pixels
+const double kPickDistance = 50.0;
+// Zoom factor of one step of the mouse wheel
+const double kZoomStep = 1.25;
+// Seconds without edits before the levels of detail are rebuilt
+const double kLodSettleTime = 0.25;
+
+// World position of a window position
+glm::dvec2 ToWorld(const Camera& camera, const ImVec2& position) {
+    return camera.toWorld(glm::dvec2(position.x, position.y));
+}
+
+void IncludeBiarc(const Biarc& biarc, glm::dvec2& lo, glm::dvec2& hi) {
+    glm::dvec2 arcLo, arcHi;
+    biarc.a.bounds(arcLo, arcHi);
+    lo = glm::min(lo, arcLo);
+    hi = glm::max(hi, arcHi);
+    biarc.b.bounds(arcLo, arcHi);
+    lo = glm::min(lo, arcLo);
+    hi = glm::max(hi, arcHi);
+}
+
+// Grow lo ... hi by the biarcs first ... last of the arc length table, which
+// are still the ones before an edit
+void IncludeSegments(const ArcLengthTable& arcLengths, size_t first,
+                     size_t last, glm::dvec2& lo, glm::dvec2& hi) {
+    for (size_t i = first; i <= last && i < arcLengths.biarcs.size(); ++i) {
+        IncludeBiarc(arcLengths.biarcs[i], lo, hi);
+    }
+}
+
+// Drop the pyramid tiles under the old biarcs in lo ... hi and under the new
+// biarcs of the segments first ... last
+void InvalidateSegments(TilePyramid& pyramid,
+                        const std::vector<glm::dvec2>& points,
+                        const std::vector<glm::vec2>& tangents,
+                        const CurveTable& curves, size_t first, size_t last,
+                        glm::dvec2 lo, glm::dvec2 hi) {
+    size_t segments = curves.segmentCount(points.size());
+    for (size_t i = first; i <= last && i < segments; ++i) {
+        IncludeBiarc(curves.segmentBiarc(points, tangents, i), lo, hi);
+    }
+    if (lo.x <= hi.x) {
+        pyramid.invalidate(lo, hi, !curves.closedFill());
+    }
+}
+
+// Replace the points and curves with the ones of a point file
+bool LoadPointFile(const std::string& path, std::vector<glm::dvec2>& points,
+                   Tangents& tangents, CurveTable& curves,
+                   PointBuffer& pointBuffer, PointFileWriter& writer) {
+    double start = glfwGetTime();
+    PointFileMapping mapping;
+    if (!mapping.open(path)) {
+        return false;
+    }
+    size_t count = static_cast<size_t>(mapping.header->count);
+    points.resize(count);
+    tangents.values.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        points[i] = mapping.point(i);
+        tangents.values[i] = mapping.tangent(i);
+    }
+    tangents.pinned.assign(mapping.pinned, mapping.pinned + count);
+    tangents.method = static_cast<TangentMethod>(mapping.header->tangentMethod);
+    curves.curves.clear();
+    for (size_t c = 0; c < mapping.curveCount; ++c) {
+        const PointFileCurve& entry = mapping.curves[c];
+        Curve curve;
+        curve.first = static_cast<size_t>(entry.first);
+        curve.count = static_cast<size_t>(entry.count);
+        curve.closed = entry.closed != 0;
+        curve.color = glm::vec4(entry.color[0], entry.color[1],
+                                entry.color[2], entry.color[3]);
+        curves.curves.push_back(curve);
+    }
+    // Files of version 1 hold one open curve
+    curves.fit(count);
+    curves.updateBounds(points, tangents.values, 0, count);
+    pointBuffer.rebuild(points, tangents);
+    writer.adopt(path, mapping);
+    mapping.close();
+    printf("loaded %zu points from %s in %.1f ms\n", count, path.c_str(),
+           (glfwGetTime() - start) * 1000.0);
+    return true;
+}
+
+// Replace the points with the knots of the biarcs of an SVG file's paths,
+// one curve per subpath
+bool ImportSvgFile(const std::string& path, double tolerance,
+                   std::vector<glm::dvec2>& points, Tangents& tangents,
+                   CurveTable& table, PointBuffer& pointBuffer,
+                   PointFileWriter& writer) {
+    double start = glfwGetTime();
+    std::vector<BiarcCurve> curves;
+    if (!ImportSvg(path, tolerance, curves)) {
+        return false;
+    }
+    points.clear();
+    tangents.pinned.clear();
+    table.curves.clear();
+    for (size_t i = 0; i < curves.size(); ++i) {
+        if (curves[i].points.empty()) {
+            continue;
+        }
+        Curve curve;
+        curve.first = points.size();
+        curve.count = curves[i].points.size();
+        curve.closed = curves[i].closed;
+        table.curves.push_back(curve);
+        points.insert(points.end(), curves[i].points.begin(),
+                      curves[i].points.end());
+        tangents.pinned.insert(tangents.pinned.end(),
+                               curves[i].tangents.begin(),
+                               curves[i].tangents.end());
+    }
+    table.fit(points.size());
+    tangents.rebuild(points, table);
+    table.updateBounds(points, tangents.values, 0, points.size());
+    pointBuffer.rebuild(points, tangents);
+    if (!points.empty()) {
+        writer.markChanged(0, points.size() - 1);
+    }
+    printf("imported %zu subpaths as %zu points from %s in %.1f ms\n",
+           curves.size(), points.size(), path.c_str(),
+           (glfwGetTime() - start) * 1000.0);
+    return true;
+}
+
+// Simplify every curve on its own, which keeps the ends of the curves
+void SimplifyCurves(Simplifier& simplifier, std::vector<glm::dvec2>& points,
+                    std::vector<glm::vec2>& pinned, CurveTable& curves,
+                    TangentMethod tangentMethod) {
+    std::vector<glm::dvec2> newPoints, curvePoints;
+    std::vector<glm::vec2> newPinned, curvePinned;
+    size_t pointsIn = 0, pointsOut = 0;
+    pinned.resize(points.size(), glm::vec2(0.0f));
+    for (size_t c = 0; c < curves.curves.size(); ++c) {
+        Curve& curve = curves.curves[c];
+        curvePoints.assign(points.begin() + curve.first,
+                           points.begin() + curve.first + curve.count);
+        curvePinned.assign(pinned.begin() + curve.first,
+                           pinned.begin() + curve.first + curve.count);
+        simplifier.apply(curvePoints, curvePinned, 0, tangentMethod);
+        pointsIn += simplifier.pointsIn;
+        pointsOut += simplifier.pointsOut;
+        curve.first = newPoints.size();
+        curve.count = curvePoints.size();
+        newPoints.insert(newPoints.end(), curvePoints.begin(),
+                         curvePoints.end());
+        newPinned.insert(newPinned.end(), curvePinned.begin(),
+                         curvePinned.end());
+    }
+    simplifier.pointsIn = pointsIn;
+    simplifier.pointsOut = pointsOut;
+    points.swap(newPoints);
+    pinned.swap(newPinned);
+}
+
+// Resample every curve on its own with a share of the count by its length,
+// but at least two points, and pin the tangents of the samples. The table
+// gives the lengths. Closed curves are sampled all the way around, without
+// repeating the first sample at the end.
+void ResampleCurves(const ArcLengthTable& arcLengths, size_t count,
+                    std::vector<glm::dvec2>& points, Tangents& tangents,
+                    CurveTable& curves) {
+    std::vector<glm::dvec2> newPoints, curvePoints, samples;
+    std::vector<glm::vec2> newPinned, curveTangents, sampleTangents;
+    double total = arcLengths.total();
+    for (size_t c = 0; c < curves.curves.size(); ++c) {
+        Curve& curve = curves.curves[c];
+        size_t end = curve.first + curve.count;
+        size_t first = newPoints.size();
+        if (curve.count < 2) {
+            newPoints.insert(newPoints.end(), points.begin() + curve.first,
+                             points.begin() + end);
+            newPinned.insert(newPinned.end(),
+                             tangents.pinned.begin() + curve.first,
+                             tangents.pinned.begin() + end);
+        } else {
+            // The closing segment of a closed curve ends at knot end
+            double length =
+                arcLengths.knotLengths[curve.closed ? end : end - 1] -
+                arcLengths.knotLengths[curve.first];
+            size_t share =
+                total > 0.0
+                    ? static_cast<size_t>(std::llround(count * length / total))
+                    : 0;
+            curvePoints.assign(points.begin() + curve.first,
+                               points.begin() + end);
+            curveTangents.assign(tangents.values.begin() + curve.first,
+                                 tangents.values.begin() + end);
+            CurveTable single;
+            single.fit(curvePoints.size());
+            single.curves.back().closed = curve.closed;
+            ArcLengthTable table;
+            table.update(curvePoints, curveTangents, single);
+            size_t sampleCount = std::max<size_t>(2, share);
+            Resample(table, curve.closed ? sampleCount + 1 : sampleCount,
+                     samples, sampleTangents);
+            if (curve.closed) {
+                samples.pop_back();
+                sampleTangents.pop_back();
+            }
+            newPoints.insert(newPoints.end(), samples.begin(), samples.end());
+            newPinned.insert(newPinned.end(), sampleTangents.begin(),
+                             sampleTangents.end());
+        }
+        curve.first = first;
+        curve.count = newPoints.size() - first;
+    }
+    points.swap(newPoints);
+    tangents.pinned.swap(newPinned);
+}
+
+// Whether the path names an SVG file
+bool IsSvgPath(const std::string& path) {
+    return path.size() > 4 && path.compare(path.size() - 4, 4, ".svg") == 0;
+}
+
+int main(int argc, char** argv) {
     App app;
     if (app.init() != 0) {
         std::cerr << "Error initializing app!" << std::endl;
         return -1;
     }
 
-    // Create and compile the vertex shader
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    // Check for vertex shader compilation errors
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, nullptr, infoLog);
-        std::cerr << "Vertex shader compilation failed:\n"
-                  << infoLog << std::endl;
-    }
-
-    // Create and compile the fragment shader
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    // Check for fragment shader compilation errors
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, nullptr, infoLog);
-        std::cerr << "Fragment shader compilation failed:\n"
-                  << infoLog << std::endl;
-    }
-
-    // Create and link the shader program
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    // Check for shader program linking errors
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, nullptr, infoLog);
-        std::cerr << "Shader program linking failed:\n" << infoLog << std::endl;
-    }
-
-    // Delete the shader objects as they are linked into the program and no
-    // longer needed
-    glDeleteShader(fragmentShader);
-    glDeleteShader(vertexShader);
-
-    // Create a Texture Buffer Object (TBO) for points
-    std::vector<glm::vec2> pointList;
-    GLuint tbo;
-    glGenBuffers(1, &tbo);
-    glBindBuffer(GL_TEXTURE_BUFFER, tbo);
-    glBufferData(GL_TEXTURE_BUFFER, pointList.size() * sizeof(glm::vec2),
-                 pointList.data(), GL_DYNAMIC_DRAW);
-
-    // Create a texture from the TBO
-    GLuint pointsTexture;
-    glGenTextures(1, &pointsTexture);
-    glBindTexture(GL_TEXTURE_BUFFER, pointsTexture);
-    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, tbo);
+    GLuint shaderProgram = CreateShaderProgram(fragmentShaderSource);
+    GLuint coarseProgram = CreateShaderProgram(coarseShaderSource);
+    GLuint offsetProgram = CreateShaderProgram(offsetShaderSource);
+    TileCandidates tileCandidates;
+    tileCandidates.init();
+    ScaledTarget scaledTarget;
+    scaledTarget.init();
+    LayerCache layerCache;
+    layerCache.init();
+    TilePyramid tilePyramid;
+    tilePyramid.init();
+    LodHierarchy lod;
+    lod.init();
+    std::vector<TileKey> missingTiles;
+    // Box of the old biarcs around inserted and erased points, taken before
+    // the arc length table shifts
+    glm::dvec2 shiftedLo(HUGE_VAL), shiftedHi(-HUGE_VAL);
+    RenderScaleController renderScale;
+    renderScale.init();
+
+    // Points with their tangents, uploaded to a TBO, and the curves they
+    // make up
+    std::vector<glm::dvec2> pointList;
+    Tangents tangents;
+    PointBuffer pointBuffer;
+    pointBuffer.init();
+    CurveTable curves;
+    CurveBuffer curveBuffer;
+    curveBuffer.init();
+    // Color of the curve new points go to
+    glm::vec4 curveColor(1.0f);
+
+    // Binary point file, SVG file and point stream, optionally given on the
+    // command line as [FILE | SVG] [--stream SOURCE]
+    char filePath[256] = "points.ecurves";
+    char svgPath[256] = "";
+    // Distance the imported biarcs may deviate from the SVG paths
+    float svgTolerance = 0.25f;
+    char gcodePath[256] = "toolpath.gcode";
+    GcodeOptions gcodeOptions;
+    PointFileWriter pointFileWriter;
+    char streamSource[256] = "-";
+    PointStream pointStream;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--stream") == 0 && i + 1 < argc) {
+            snprintf(streamSource, sizeof(streamSource), "%s", argv[++i]);
+            pointStream.open(streamSource);
+        } else if (IsSvgPath(argv[i])) {
+            snprintf(svgPath, sizeof(svgPath), "%s", argv[i]);
+            ImportSvgFile(svgPath, svgTolerance, pointList, tangents, curves,
+                          pointBuffer, pointFileWriter);
+        } else {
+            snprintf(filePath, sizeof(filePath), "%s", argv[i]);
+            LoadPointFile(filePath, pointList, tangents, curves, pointBuffer,
+                          pointFileWriter);
+        }
+    }
+
+    // TBOs for the per-column crossing table
+    CrossingTable crossingTable;
+    std::vector<Biarc> biarcs;
+    GLuint crossingTbos[2];
+    GLuint crossingTextures[2];
+    glGenBuffers(2, crossingTbos);
+    glGenTextures(2, crossingTextures);
+    glBindBuffer(GL_TEXTURE_BUFFER, crossingTbos[0]);
+    glBindTexture(GL_TEXTURE_BUFFER, crossingTextures[0]);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32I, crossingTbos[0]);
+    glBindBuffer(GL_TEXTURE_BUFFER, crossingTbos[1]);
+    glBindTexture(GL_TEXTURE_BUFFER, crossingTextures[1]);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, crossingTbos[1]);
+    int crossingColumns = 0;
+
+    // Distance field from jump flooding
+    JumpFlood jumpFlood;
+    jumpFlood.init();
+
+    // Triangle strip renderer, an alternative to the full-screen SDF
+    StrokeRenderer strokeRenderer;
+    strokeRenderer.init();
+    bool strokeDirty = true;
+
+    // CPU biarcs, rebuilt lazily for the passes that need them
+    bool biarcsDirty = true;
+    bool crossingsDirty = true;
+
+    // Arc length along the curve, and the sample count of the resampler
+    ArcLengthTable arcLengths;
+    int sampleCount = 1000;
+    // Nearest point of the curve to the cursor while placing points
+    CurvePicker curvePicker;
+    CurvePick curvePick;
+    bool hasCurvePick = false;
+
+    // Offset curves on both sides at multiples of the distance
+    bool showOffsets = false;
+    float offsetDistance = 20.0f;
+    int offsetCount = 1;
+    bool offsetsDirty = true;
+    double offsetMs = 0.0;
+    std::vector<glm::dvec2> offsetPoints;
+    Tangents offsetTangents;
+    PointBuffer offsetBuffer;
+    offsetBuffer.init();
+
+    // View of the world, and the view the window-space state was built for
+    Camera camera;
+    Camera drawnCamera;
+    std::vector<glm::dvec2> viewPoints;
+
+    // Curve of the last edit, the dynamic layer, and how often the static
+    // layer was redrawn
+    int activeCurve = -1;
+    size_t layerRedraws = 0;
 
     int nearestIndex = -1;
     int nearestIdxWhenClicked = -1;
+    std::vector<CursorEvent> cursorEvents;
+    Simplifier simplifier;
     while (!glfwWindowShouldClose(app.window) &&
            !glfwGetKey(app.window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
         glfwPollEvents();
+        cursorEvents.clear();
+        app.cursor.drain(cursorEvents);
+
+        // Points changed this frame, for consumers that update incrementally
+        bool pointsChanged = false;
+        size_t changedFirst = 0, changedLast = 0;
+        // Points inserted or erased at editIndex this frame. The tangents
+        // and arc lengths shift right away, the point buffer follows below.
+        size_t editIndex = 0, pointsInserted = 0, pointsErased = 0;
+        // Time of the input event this frame shows, for the latency monitor
+        double inputTime = -1.0;
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -575,10 +1685,331 @@ int main() {
         ImGui::RadioButton("Place Points", &isPlacingPoints, 1);
         ImGui::SameLine();
         ImGui::RadioButton("Move Points", &isPlacingPoints, 0);
+        ImGui::SameLine();
+        ImGui::RadioButton("Freehand", &isPlacingPoints, 2);
+        static float freehandSpacing = 4.0f;
+        if (isPlacingPoints == 2) {
+            ImGui::SliderFloat("Spacing", &freehandSpacing, 1.0f, 32.0f);
+            ImGui::Text("%zu cursor events last frame", cursorEvents.size());
+        }
+
+        // Placed and streamed points go to the last curve, every freehand
+        // stroke starts a curve of its own
+        if (ImGui::ColorEdit3("Color", glm::value_ptr(curveColor))) {
+            curves.fit(pointList.size());
+            curves.curves.back().color = curveColor;
+            layerCache.valid = false;
+            // Fills take the color of the nearest curve, however far
+            tilePyramid.clear();
+            lod.markChanged(glfwGetTime());
+        }
+        if (ImGui::Button("New curve")) {
+            curves.addCurve(pointList.size(), curveColor);
+        }
+        ImGui::SameLine();
+        bool closed = !curves.curves.empty() && curves.curves.back().closed;
+        if (ImGui::Checkbox("Closed", &closed)) {
+            curves.fit(pointList.size());
+            Curve& curve = curves.curves.back();
+            curve.closed = closed;
+            // Both ends change their tangents and the closing segment
+            if (curve.count > 0) {
+                pointsChanged = true;
+                changedFirst = curve.first;
+                changedLast = curve.first + curve.count - 1;
+            }
+        }
+        ImGui::SameLine();
+        ImGui::Text("%zu curves", curves.curves.size());
+
+        ImGui::InputText("File", filePath, sizeof(filePath));
+        if (ImGui::Button("Load") &&
+            LoadPointFile(filePath, pointList, tangents, curves, pointBuffer,
+                          pointFileWriter)) {
+            nearestIndex = -1;
+            nearestIdxWhenClicked = -1;
+            strokeDirty = true;
+            biarcsDirty = true;
+            offsetsDirty = true;
+            layerCache.valid = false;
+            tilePyramid.clear();
+            lod.markChanged(glfwGetTime());
+            arcLengths.markChanged(0, pointList.size());
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Save")) {
+            double start = glfwGetTime();
+            if (pointFileWriter.save(filePath, pointList, tangents, curves)) {
+                printf("saved %zu points to %s in %.1f ms\n", pointList.size(),
+                       filePath, (glfwGetTime() - start) * 1000.0);
+            }
+        }
+
+        ImGui::InputText("SVG", svgPath, sizeof(svgPath));
+        ImGui::SameLine();
+        if (ImGui::Button("Import") &&
+            ImportSvgFile(svgPath, svgTolerance, pointList, tangents, curves,
+                          pointBuffer, pointFileWriter)) {
+            nearestIndex = -1;
+            nearestIdxWhenClicked = -1;
+            strokeDirty = true;
+            biarcsDirty = true;
+            offsetsDirty = true;
+            layerCache.valid = false;
+            tilePyramid.clear();
+            lod.markChanged(glfwGetTime());
+            arcLengths.markChanged(0, pointList.size());
+        }
+        ImGui::SliderFloat("SVG tolerance (px)", &svgTolerance, 0.01f, 4.0f);
+
+        ImGui::InputText("G-code", gcodePath, sizeof(gcodePath));
+        ImGui::SameLine();
+        if (ImGui::Button("Export")) {
+            double start = glfwGetTime();
+            GcodeStats stats;
+            if (ExportGcode(gcodePath, pointList, tangents.values, curves,
+                            gcodeOptions, stats)) {
+                double seconds = glfwGetTime() - start;
+                printf("exported %zu segments as %zu arcs and %zu lines to %s "
+                       "in %.1f ms, %.1f MB/s\n",
+                       stats.segments, stats.arcs, stats.lines, gcodePath,
+                       seconds * 1000.0, stats.bytes * 1.e-6 / seconds);
+            }
+        }
+        ImGui::InputDouble("mm per px", &gcodeOptions.scale);
+        ImGui::InputDouble("Feed (mm/min)", &gcodeOptions.feedRate);
+
+        ImGui::InputText("Stream", streamSource, sizeof(streamSource));
+        ImGui::SameLine();
+        if (pointStream.isOpen()) {
+            if (ImGui::Button("Disconnect")) {
+                pointStream.close();
+            }
+            ImGui::Text("Received %zu points%s", pointStream.received(),
+                        pointStream.ended() ? ", end of input" : "");
+        } else if (ImGui::Button("Connect")) {
+            pointStream.open(streamSource);
+        }
+
+        int tangentMethod = tangents.method;
+        if (ImGui::Combo("Tangents", &tangentMethod, kTangentMethodNames,
+                         kTangentMethodCount)) {
+            tangents.method = static_cast<TangentMethod>(tangentMethod);
+            tangents.rebuild(pointList, curves);
+            curves.updateBounds(pointList, tangents.values, 0,
+                                pointList.size());
+            pointBuffer.rebuild(pointList, tangents);
+            if (!pointList.empty()) {
+                pointFileWriter.markChanged(0, pointList.size() - 1);
+            }
+            strokeDirty = true;
+            biarcsDirty = true;
+            offsetsDirty = true;
+            layerCache.valid = false;
+            tilePyramid.clear();
+            lod.markChanged(glfwGetTime());
+            arcLengths.markChanged(0, pointList.size());
+        }
+
+        int simplifyMethod = simplifier.method;
+        if (ImGui::Combo("Simplify", &simplifyMethod, kSimplifyMethodNames,
+                         kSimplifyMethodCount)) {
+            simplifier.method = static_cast<SimplifyMethod>(simplifyMethod);
+        }
+        ImGui::SliderFloat("Tolerance (px)", &simplifier.tolerance, 0.05f,
+                           10.0f);
+        ImGui::Checkbox("Simplify input", &simplifier.onInput);
+        ImGui::SameLine();
+        if (ImGui::Button("Simplify curves")) {
+            SimplifyCurves(simplifier, pointList, tangents.pinned, curves,
+                           tangents.method);
+            tangents.rebuild(pointList, curves);
+            curves.updateBounds(pointList, tangents.values, 0,
+                                pointList.size());
+            pointBuffer.rebuild(pointList, tangents);
+            if (!pointList.empty()) {
+                pointFileWriter.markChanged(0, pointList.size() - 1);
+            }
+            nearestIndex = -1;
+            strokeDirty = true;
+            biarcsDirty = true;
+            offsetsDirty = true;
+            layerCache.valid = false;
+            tilePyramid.clear();
+            lod.markChanged(glfwGetTime());
+            arcLengths.markChanged(0, pointList.size());
+        }
+        ImGui::SameLine();
+        ImGui::Text("%zu -> %zu points", simplifier.pointsIn,
+                    simplifier.pointsOut);
+
+        // Evenly spaced points along the curve, with the curve's tangents
+        // pinned so that the biarcs through them follow it
+        arcLengths.update(pointList, tangents.values, curves);
+        curvePicker.update(arcLengths);
+        ImGui::SliderInt("Samples", &sampleCount, 2, 100000, "%d",
+                         ImGuiSliderFlags_Logarithmic);
+        ImGui::SameLine();
+        if (ImGui::Button("Resample") && pointList.size() > 1) {
+            double start = glfwGetTime();
+            size_t oldCount = pointList.size();
+            ResampleCurves(arcLengths, sampleCount, pointList, tangents,
+                           curves);
+            printf("resampled %zu points to %zu in %.1f ms\n", oldCount,
+                   pointList.size(), (glfwGetTime() - start) * 1000.0);
+            tangents.rebuild(pointList, curves);
+            curves.updateBounds(pointList, tangents.values, 0,
+                                pointList.size());
+            pointBuffer.rebuild(pointList, tangents);
+            pointFileWriter.markChanged(0, pointList.size() - 1);
+            nearestIndex = -1;
+            strokeDirty = true;
+            biarcsDirty = true;
+            offsetsDirty = true;
+            layerCache.valid = false;
+            tilePyramid.clear();
+            lod.markChanged(glfwGetTime());
+            arcLengths.markChanged(0, pointList.size());
+        }
+        ImGui::Text("Length %.1f px", arcLengths.total());
+        if (isPlacingPoints == 1 && hasCurvePick) {
+            const Curve& curve =
+                curves.curves[curves.curveAt(curvePick.segment)];
+            ImGui::SameLine();
+            ImGui::Text("Cursor on curve %zu, segment %zu, arc %d at %.3f, "
+                        "length %.1f",
+                        curves.curveAt(curvePick.segment),
+                        curvePick.segment - curve.first, curvePick.arc,
+                        curvePick.u,
+                        curvePick.length - arcLengths.knotLengths[curve.first]);
+        }
+
+        // 16-bit points relative to per-block origins
+        if (ImGui::Checkbox("Compact points", &pointBuffer.compact)) {
+            pointBuffer.rebuild(pointList, tangents);
+        }
+        ImGui::SameLine();
+        ImGui::Text("%.1f KiB", pointBuffer.gpuBytes() / 1024.0);
+
+        static bool scanlineSignChosen = false;
+        ImGui::Checkbox("Scanline fill sign", &scanlineSignChosen);
+        // The candidates only give distances, the sign comes from the table
+        // unless all curves are closed and the tiles carry it
+        static bool useTileCandidates = false;
+        ImGui::Checkbox("Tile candidates", &useTileCandidates);
+
+        // Jump flooding only gives distances, too
+        static bool useJumpFlood = false;
+        static bool refineJumpFlood = true;
+        ImGui::Checkbox("Jump flood", &useJumpFlood);
+        if (useJumpFlood) {
+            ImGui::SameLine();
+            ImGui::Checkbox("Refine", &refineJumpFlood);
+        }
+
+        // Derived every frame, so the tile fill sign takes over again as
+        // soon as all curves are closed
+        bool useScanlineSign = scanlineSignChosen || useJumpFlood ||
+                               (useTileCandidates && !curves.closedFill());
+
+        // Plain stroke without any distance field
+        static bool useStrokeRenderer = false;
+        ImGui::Checkbox("Stroke renderer", &useStrokeRenderer);
+        if (useStrokeRenderer) {
+            ImGui::SameLine();
+            if (ImGui::SliderFloat("Width", &strokeRenderer.halfWidth, 0.5f,
+                                   20.0f)) {
+                strokeDirty = true;
+            }
+        }
+
+        // Input-to-GPU latency of the frames that showed an input event
+        static bool lateLatch = false;
+        ImGui::Checkbox("Late latch", &lateLatch);
+        ImGui::SameLine();
+        ImGui::Text("Latency p50 %.1f p95 %.1f p99 %.1f ms",
+                    app.latency.percentile(0.5), app.latency.percentile(0.95),
+                    app.latency.percentile(0.99));
+
+        // Cache all curves but the edited one in a static layer
+        static bool useLayers = false;
+        ImGui::Checkbox("Layers", &useLayers);
+        if (useLayers) {
+            ImGui::SameLine();
+            ImGui::Text("Static layer drawn %zu times", layerRedraws);
+        }
+
+        // Tiles of the canvas at power of two zoom levels, each drawn once
+        static bool useTilePyramid = false;
+        ImGui::Checkbox("Tile pyramid", &useTilePyramid);
+        if (useTilePyramid) {
+            static int budgetMiB = static_cast<int>(tilePyramid.budget() >> 20);
+            ImGui::SameLine();
+            ImGui::SliderInt("Budget (MiB)", &budgetMiB, 4, 1024);
+            if (ImGui::IsItemDeactivatedAfterEdit()) {
+                tilePyramid.setBudget(size_t(budgetMiB) << 20);
+            }
+            ImGui::Text("%zu tiles cached at level %d, %.1f MiB",
+                        tilePyramid.tileCount(), TileLevel(camera),
+                        tilePyramid.gpuBytes() / 1048576.0);
+        }
+
+        // Simplified curves for zoomed out views
+        static bool useLod = false;
+        ImGui::Checkbox("Level of detail", &useLod);
+        if (useLod) {
+            ImGui::SameLine();
+            if (ImGui::SliderFloat("LOD error (px)", &lod.pixelError, 0.05f,
+                                   2.0f)) {
+                lod.markChanged(glfwGetTime());
+                tilePyramid.clear();
+            }
+            int shownLevel = lod.select(camera.scale);
+            ImGui::Text("Level %d of %d, %zu points, built in %.1f ms "
+                        "refitting %zu curves%s",
+                        shownLevel, lod.levelCount() - 1,
+                        shownLevel > 0 ? lod.level(shownLevel).points.size()
+                                       : pointList.size(),
+                        lod.buildMs, lod.refitCount,
+                        lod.isStale() ? " (stale)" : "");
+        }
+
+        // The wheel zooms, the middle button drags the view
+        if (ImGui::Button("Reset view")) {
+            camera = Camera();
+        }
+        ImGui::SameLine();
+        ImGui::Text("Zoom %.3g, origin %.9g %.9g", camera.scale,
+                    camera.origin.x, camera.origin.y);
+
+        static bool useDynamicResolution = false;
+        ImGui::Checkbox("Dynamic resolution", &useDynamicResolution);
+        if (useDynamicResolution) {
+            ImGui::SliderFloat("Frame budget (ms)", &renderScale.budgetMs, 1.0f,
+                               33.0f);
+            ImGui::Text("Scale %.2f, GPU %.2f ms", renderScale.scale,
+                        renderScale.gpuMs);
+        }
+
+        if (ImGui::Checkbox("Offsets", &showOffsets)) {
+            offsetsDirty = true;
+        }
+        if (showOffsets) {
+            ImGui::SameLine();
+            // In world units, like the points
+            offsetsDirty |= ImGui::SliderFloat(
+                "Distance", &offsetDistance, 0.01f, 10000.0f, "%.3g",
+                ImGuiSliderFlags_Logarithmic);
+            offsetsDirty |= ImGui::SliderInt("Count", &offsetCount, 1, 10);
+            ImGui::SameLine();
+            ImGui::Text("%zu knots in %.1f ms", offsetPoints.size(), offsetMs);
+        }
 
         // Point annotations
-        for (size_t i = 0; i < pointList.size(); ++i) {
-            const glm::vec2& point = pointList[i];
+        size_t annotatedCount =
+            pointList.size() <= kMaxAnnotatedPoints ? pointList.size() : 0;
+        for (size_t i = 0; i < annotatedCount; ++i) {
+            glm::vec2 point(camera.toView(glm::dvec2(pointList[i])));
             // Make the ImGui window transparent
             ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 0.0f);
             ImGui::PushStyleVar(ImGuiStyleVar_WindowBorderSize, 0.0f);
@@ -607,41 +2038,143 @@ int main() {
         ImGui::End();
         ImGui::Render();
 
+        // Newest cursor position. ImGui spreads queued input over several
+        // frames when buttons change, so its position can lag behind.
+        ImVec2 cursorPos = ImGui::GetMousePos();
+        if (!cursorEvents.empty()) {
+            const glm::dvec2& newest = cursorEvents.back().position;
+            cursorPos = ImVec2(static_cast<float>(newest.x),
+                               static_cast<float>(newest.y));
+        }
+
         // Only do mouse events if Imgui doesn't capture them
         if (!ImGui::GetIO().WantCaptureMouse) {
+            // The wheel zooms around the cursor, the middle button drags
+            // the view
+            ImGuiIO& io = ImGui::GetIO();
+            if (io.MouseWheel != 0.0f) {
+                camera.zoomAt(glm::dvec2(cursorPos.x, cursorPos.y),
+                              std::pow(kZoomStep, io.MouseWheel));
+            }
+            if (ImGui::IsMouseDragging(2, 0.0f)) {
+                camera.pan(glm::dvec2(io.MouseDelta.x, io.MouseDelta.y));
+            }
+
             if (isPlacingPoints == 1) {
-                if (ImGui::IsMouseClicked(0)) {
-                    ImVec2 mousePos = ImGui::GetMousePos();
+                // Clicking near the curve inserts the nearest point of the
+                // curve into it, elsewhere the point is appended
+                glm::dvec2 mousePos = ToWorld(camera, ImGui::GetMousePos());
+                // The empty segments between curves take no points
+                hasCurvePick = curvePicker.pick(arcLengths, mousePos,
+                                                kInsertDistance / camera.scale,
+                                                curvePick) &&
+                               curves.joins(curvePick.segment);
+                // A pick on a knot would only duplicate it. On the last
+                // point the click appends, elsewhere it does nothing.
+                bool onKnot = false;
+                bool onLastPoint = false;
+                if (hasCurvePick) {
+                    size_t a = curvePick.segment;
+                    size_t b = curves.segmentEnd(a);
+                    double snap = kKnotSnapDistance / camera.scale;
+                    glm::dvec2 pick = curvePick.point;
+                    bool onA =
+                        glm::distance(pick, glm::dvec2(pointList[a])) <= snap;
+                    bool onB =
+                        glm::distance(pick, glm::dvec2(pointList[b])) <= snap;
+                    onKnot = onA || onB;
+                    onLastPoint = (onA && a == pointList.size() - 1) ||
+                                  (onB && b == pointList.size() - 1);
+                    hasCurvePick = !onKnot;
+                }
+                if (ImGui::IsMouseClicked(0) && hasCurvePick) {
+                    size_t i = curvePick.segment + 1;
+                    // The CPU arrays stay contiguous, so this moves
+                    // everything after i: the points, the tangents and the
+                    // 176-byte biarcs. That is about 25 ms at a million
+                    // points, and a few hundred when one of them grows.
+                    // Only the uploads and the rebuilt pages and pick
+                    // chunks stay local to the edit.
+                    pointList.insert(pointList.begin() + i, curvePick.point);
+                    tangents.insert(i, 1);
+                    IncludeSegments(arcLengths, i > 1 ? i - 2 : 0, i,
+                                    shiftedLo, shiftedHi);
+                    arcLengths.insert(i, 1);
+                    curves.insert(i, 1);
+                    hasCurvePick = false;
+
+                    pointsChanged = true;
+                    changedFirst = changedLast = editIndex = i;
+                    pointsInserted = 1;
+                } else if (ImGui::IsMouseClicked(0) &&
+                           (!onKnot || onLastPoint)) {
                     printf("adding point at %f %f\n", mousePos.x, mousePos.y);
 
-                    pointList.push_back(glm::vec2(mousePos.x, mousePos.y));
+                    pointList.push_back(mousePos);
                     // std::stable_sort(
                     //     pointList.begin(), pointList.end(),
                     //     [](const glm::vec2& a, const glm::vec2& b) {
                     //         return a.x < b.x;
                     //     });
 
-                    glBindBuffer(GL_TEXTURE_BUFFER, tbo);
-                    glBufferData(GL_TEXTURE_BUFFER,
-                                 pointList.size() * sizeof(glm::vec2),
-                                 pointList.data(), GL_DYNAMIC_DRAW);
+                    pointsChanged = true;
+                    changedFirst = changedLast = pointList.size() - 1;
+                }
+            } else if (isPlacingPoints == 2) {
+                // Every cursor event while the button is down is a candidate
+                // point, kept if it is far enough from the previous one
+                static bool isDrawing = false;
+                static size_t strokeFirst = 0;
+                size_t first = pointList.size();
+                if (ImGui::IsMouseClicked(0)) {
+                    isDrawing = true;
+                    strokeFirst = first;
+                    curves.addCurve(first, curveColor);
+                    pointList.push_back(ToWorld(camera, ImGui::GetMousePos()));
+                }
+                double spacing = freehandSpacing / camera.scale;
+                for (size_t i = 0; isDrawing && i < cursorEvents.size(); ++i) {
+                    glm::dvec2 position =
+                        camera.toWorld(cursorEvents[i].position);
+                    if (cursorEvents[i].pressed &&
+                        (pointList.empty() ||
+                         glm::distance(position, pointList.back()) >=
+                             spacing)) {
+                        pointList.push_back(position);
+                    }
+                }
+                if (isDrawing && !ImGui::IsMouseDown(0)) {
+                    isDrawing = false;
+                    // The stroke is done, simplify it as a whole
+                    if (simplifier.onInput) {
+                        simplifier.apply(pointList, tangents.pinned,
+                                         strokeFirst, tangents.method);
+                        first = std::min(first, strokeFirst);
+                    }
+                }
+                if (pointList.size() > first) {
+                    changedFirst = first;
+                    changedLast = pointList.size() - 1;
+                    pointsChanged = true;
+                    if (!cursorEvents.empty()) {
+                        inputTime = cursorEvents.back().time;
+                    }
                 }
             } else {
-                ImVec2 mousePos = ImGui::GetMousePos();
-                nearestIndex = FindNearestPoint(
-                    glm::vec2(mousePos.x, mousePos.y), pointList);
+                glm::dvec2 mousePos = ToWorld(camera, cursorPos);
+                nearestIndex = FindNearestPoint(mousePos, pointList,
+                                                kPickDistance / camera.scale);
                 if (ImGui::IsMouseClicked(0)) {
                     nearestIdxWhenClicked = nearestIndex;
                 }
                 if (ImGui::IsMouseDragging(0, 0.0f) &&
                     nearestIdxWhenClicked != -1) {
-                    std::vector<glm::vec2> pointListNew = pointList;
-                    pointListNew[nearestIdxWhenClicked] =
-                        glm::vec2(mousePos.x, mousePos.y);
+                    std::vector<glm::dvec2> pointListNew = pointList;
+                    pointListNew[nearestIdxWhenClicked] = mousePos;
 
                     const auto nearestPoint =
                         (nearestIndex != -1 ? pointListNew[nearestIndex]
-                                            : glm::vec2{-1.0f, -1.0f});
+                                            : glm::dvec2{-1.0, -1.0});
                     const auto nearestPointWhenClicked =
                         pointListNew[nearestIdxWhenClicked];
 
@@ -661,52 +2194,605 @@ int main() {
                         pointList[i] = pointListNew[i];
                     }
 
-                    glBindBuffer(GL_TEXTURE_BUFFER, tbo);
-                    glBufferData(GL_TEXTURE_BUFFER,
-                                 pointList.size() * sizeof(glm::vec2),
-                                 pointList.data(), GL_DYNAMIC_DRAW);
+                    pointsChanged = true;
+                    changedFirst = changedLast = nearestIdxWhenClicked;
+                    if (!cursorEvents.empty()) {
+                        inputTime = cursorEvents.back().time;
+                    }
                 } else {
                     nearestIdxWhenClicked = -1;
                 }
+
+                // Delete erases the point under the cursor
+                if (nearestIndex != -1 && nearestIdxWhenClicked == -1 &&
+                    !ImGui::GetIO().WantCaptureKeyboard &&
+                    ImGui::IsKeyPressed(ImGuiKey_Delete)) {
+                    size_t i = nearestIndex;
+                    pointList.erase(pointList.begin() + i);
+                    tangents.erase(i, 1);
+                    IncludeSegments(arcLengths, i > 1 ? i - 2 : 0, i + 1,
+                                    shiftedLo, shiftedHi);
+                    arcLengths.erase(i, 1);
+                    curves.erase(i, 1);
+                    nearestIndex = -1;
+
+                    pointsChanged = true;
+                    changedFirst = changedLast = editIndex = i;
+                    pointsErased = 1;
+                }
+
+                // Right-dragging from a point pins its tangent toward the
+                // cursor, a right click without dragging unpins it
+                static int pinIndex = -1;
+                static bool pinDragged = false;
+                if (ImGui::IsMouseClicked(1)) {
+                    pinIndex = nearestIndex;
+                    pinDragged = false;
+                }
+                if (pinIndex != -1) {
+                    size_t i = pinIndex;
+                    glm::vec2 direction(mousePos - pointList[i]);
+                    bool pinChanged = false;
+                    if (ImGui::IsMouseDragging(1) &&
+                        direction != glm::vec2(0.0f)) {
+                        tangents.pin(i, direction);
+                        pinDragged = true;
+                        pinChanged = true;
+                    } else if (ImGui::IsMouseReleased(1)) {
+                        if (!pinDragged && tangents.isPinned(i)) {
+                            tangents.unpin(i);
+                            pinChanged = true;
+                        }
+                        pinIndex = -1;
+                    }
+                    if (pinChanged) {
+                        changedFirst =
+                            pointsChanged ? std::min(changedFirst, i) : i;
+                        changedLast =
+                            pointsChanged ? std::max(changedLast, i) : i;
+                        pointsChanged = true;
+                    }
+                }
+            }
+        }
+
+        // Append the streamed points in one batch per frame
+        size_t streamed = pointStream.drain(pointList, kMaxStreamBatch);
+        if (streamed > 0) {
+            size_t first = pointList.size() - streamed;
+            if (simplifier.onInput) {
+                // From the previous point on, if it is on the same curve
+                curves.fit(pointList.size());
+                first = first > curves.curves.back().first ? first - 1 : first;
+                simplifier.apply(pointList, tangents.pinned, first,
+                                 tangents.method);
             }
+            changedFirst = pointsChanged ? std::min(changedFirst, first) : first;
+            changedLast = pointList.size() - 1;
+            pointsChanged = true;
+        }
+
+        // The crossing table, the jump flood, the stroke and the static layer
+        // are in window pixels
+        if (camera != drawnCamera) {
+            if (camera.scale != drawnCamera.scale) {
+                strokeRenderer.viewScale = camera.scale;
+                strokeDirty = true;
+            }
+            biarcsDirty = true;
+            layerCache.valid = false;
+            drawnCamera = camera;
+        }
+
+        if (pointsChanged) {
+            // Appended points go to the last curve
+            curves.fit(pointList.size());
+            lod.markChanged(glfwGetTime());
+            // An edit within one curve makes it the dynamic layer, others
+            // change the static layer. An erased point may have been the
+            // last one of the curve before.
+            size_t editCurve = curves.curveAt(changedLast);
+            if (curves.curveAt(pointsErased > 0 && changedFirst > 0
+                                   ? changedFirst - 1
+                                   : changedFirst) == editCurve) {
+                activeCurve = static_cast<int>(editCurve);
+            } else {
+                layerCache.valid = false;
+            }
+            // Moving a point changes the tangents of its neighbors, too
+            tangents.update(pointList, curves, changedFirst, changedLast);
+            curves.updateBounds(pointList, tangents.values,
+                                changedFirst > 0 ? changedFirst - 1 : 0,
+                                changedLast + 1);
+            bool shifted = pointsInserted > 0 || pointsErased > 0;
+            if (tilePyramid.tileCount() > 0) {
+                // The table still holds the old biarcs unless it shifted,
+                // then the edit took their box. Edits up to the end may
+                // have dropped segments past it.
+                size_t first = changedFirst > 1 ? changedFirst - 2 : 0;
+                size_t last = changedLast + 1;
+                glm::dvec2 lo = shiftedLo, hi = shiftedHi;
+                if (!shifted) {
+                    IncludeSegments(arcLengths, first,
+                                    last + 1 >= pointList.size()
+                                        ? arcLengths.biarcs.size()
+                                        : last,
+                                    lo, hi);
+                }
+                InvalidateSegments(tilePyramid, pointList, tangents.values,
+                                   curves, first, last, lo, hi);
+            }
+            shiftedLo = glm::dvec2(HUGE_VAL);
+            shiftedHi = glm::dvec2(-HUGE_VAL);
+            if (pointsInserted > 0) {
+                pointBuffer.insert(pointList, tangents, editIndex,
+                                   pointsInserted);
+            } else if (pointsErased > 0) {
+                pointBuffer.erase(pointList, tangents, editIndex,
+                                  pointsErased);
+            }
+            pointBuffer.update(pointList, tangents,
+                               changedFirst > 0 ? changedFirst - 1 : 0,
+                               changedLast + 1);
+            // Records after an insert or erase move in the file, so the
+            // next save rewrites all of them
+            pointFileWriter.markChanged(
+                changedFirst > 0 ? changedFirst - 1 : 0,
+                shifted ? pointList.size() : changedLast + 1);
+            biarcsDirty = true;
+            offsetsDirty = true;
+            arcLengths.markChanged(changedFirst > 0 ? changedFirst - 1 : 0,
+                                   changedLast + 1);
+            if (useStrokeRenderer && !strokeDirty && !shifted) {
+                strokeRenderer.update(pointList, tangents.values, curves,
+                                      changedFirst, changedLast);
+            } else {
+                strokeDirty = true;
+            }
+            // The tangents across the seams of closed curves changed, too
+            size_t seams[2];
+            size_t seamCount =
+                curves.seamNeighbors(changedFirst, changedLast, seams);
+            for (size_t k = 0; k < seamCount; ++k) {
+                size_t seam = seams[k];
+                curves.updateBounds(pointList, tangents.values, seam, seam);
+                if (tilePyramid.tileCount() > 0) {
+                    // An insert left an empty slot in the table
+                    glm::dvec2 lo(HUGE_VAL), hi(-HUGE_VAL);
+                    for (size_t s = seam > 0 ? seam - 1 : 0; s <= seam; ++s) {
+                        if (pointsInserted == 0 || s != editIndex) {
+                            IncludeSegments(arcLengths, s, s, lo, hi);
+                        }
+                    }
+                    InvalidateSegments(tilePyramid, pointList,
+                                       tangents.values, curves,
+                                       seam > 0 ? seam - 1 : 0, seam, lo, hi);
+                }
+                pointBuffer.update(pointList, tangents, seam, seam);
+                pointFileWriter.markChanged(seam, seam);
+                arcLengths.markChanged(seam, seam);
+                if (useStrokeRenderer && !strokeDirty) {
+                    strokeRenderer.update(pointList, tangents.values, curves,
+                                          seam, seam);
+                }
+            }
+        }
+        if (useStrokeRenderer && strokeDirty) {
+            strokeRenderer.rebuild(pointList, tangents.values, curves);
+            strokeDirty = false;
+        }
+
+        if (biarcsDirty && (useScanlineSign || useJumpFlood)) {
+            camera.toView(pointList, viewPoints);
+            BuildBiarcs(viewPoints, tangents.values, curves, biarcs);
+            jumpFlood.setBiarcs(biarcs);
+            crossingsDirty = true;
+            biarcsDirty = false;
+        }
+
+        // Rebuild the crossing table on point changes and resizes
+        if (useScanlineSign &&
+            (crossingsDirty || crossingColumns != app.width)) {
+            crossingTable.build(biarcs, app.width);
+            glBindBuffer(GL_TEXTURE_BUFFER, crossingTbos[0]);
+            glBufferData(GL_TEXTURE_BUFFER,
+                         crossingTable.offsets.size() * sizeof(int),
+                         crossingTable.offsets.data(), GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_TEXTURE_BUFFER, crossingTbos[1]);
+            glBufferData(GL_TEXTURE_BUFFER,
+                         crossingTable.values.size() * sizeof(float),
+                         crossingTable.values.data(), GL_DYNAMIC_DRAW);
+            crossingsDirty = false;
+            crossingColumns = app.width;
+        }
+
+        if (showOffsets && offsetsDirty) {
+            double start = glfwGetTime();
+            offsetPoints.clear();
+            offsetTangents.values.clear();
+            std::vector<BiarcCurve> offsets;
+            std::vector<glm::dvec2> curvePoints;
+            std::vector<glm::vec2> curveTangents;
+            for (size_t c = 0; c < curves.curves.size(); ++c) {
+                const Curve& curve = curves.curves[c];
+                if (curve.count < 2) {
+                    continue;
+                }
+                size_t end = curve.first + curve.count;
+                curvePoints.assign(pointList.begin() + curve.first,
+                                   pointList.begin() + end);
+                curveTangents.assign(tangents.values.begin() + curve.first,
+                                     tangents.values.begin() + end);
+                // The spline of a closed curve returns to its first knot
+                if (curve.closed) {
+                    curvePoints.push_back(curvePoints.front());
+                    curveTangents.push_back(curveTangents.front());
+                }
+                for (int k = -offsetCount; k <= offsetCount; ++k) {
+                    if (k == 0) {
+                        continue;
+                    }
+                    OffsetSpline(curvePoints, curveTangents,
+                                 k * offsetDistance, offsets);
+                    for (size_t o = 0; o < offsets.size(); ++o) {
+                        if (!offsetPoints.empty()) {
+                            offsetPoints.push_back(offsetPoints.back());
+                            offsetTangents.values.push_back(glm::vec2(0.0f));
+                        }
+                        offsetPoints.insert(offsetPoints.end(),
+                                            offsets[o].points.begin(),
+                                            offsets[o].points.end());
+                        offsetTangents.values.insert(
+                            offsetTangents.values.end(),
+                            offsets[o].tangents.begin(),
+                            offsets[o].tangents.end());
+                    }
+                }
+            }
+            offsetBuffer.rebuild(offsetPoints, offsetTangents);
+            offsetsDirty = false;
+            offsetMs = (glfwGetTime() - start) * 1000.0;
+        }
+
+        // Lower the resolution while a point is being dragged
+        renderScale.update(useDynamicResolution && nearestIdxWhenClicked != -1);
+        renderScale.beginPass();
+
+        // The picker culls the segments, so it follows this frame's edits
+        arcLengths.update(pointList, tangents.values, curves);
+        curvePicker.update(arcLengths);
+        curveBuffer.update(curves);
+        curveBuffer.cull(camera, app.width, app.height, curvePicker);
+
+        // Zoomed out, a level of detail stands in for the curves. The levels
+        // are rebuilt once the edits settle, and the tiles of the pyramid
+        // take the level of their scale.
+        bool lodEnabled =
+            useLod && !useScanlineSign && !useJumpFlood && !useStrokeRenderer;
+        int lodLevel = 0;
+        if (lodEnabled) {
+            if (nearestIdxWhenClicked == -1 &&
+                lod.needsBuild(glfwGetTime(), kLodSettleTime)) {
+                double start = glfwGetTime();
+                lod.build(pointList, tangents, curves);
+                lod.buildMs = (glfwGetTime() - start) * 1000.0;
+            }
+            lodLevel = lod.select(useTilePyramid
+                                      ? std::ldexp(1.0, TileLevel(camera))
+                                      : camera.scale);
+        }
+        PointBuffer* drawPoints = &pointBuffer;
+        CurveBuffer* drawCurves = &curveBuffer;
+        const CurvePicker* drawPicker = &curvePicker;
+        GLint drawPointCount = static_cast<GLint>(pointList.size());
+        if (lodLevel > 0) {
+            lod.upload(lodLevel, pointBuffer.compact);
+            drawPoints = &lod.pointBuffer;
+            drawCurves = &lod.curveBuffer;
+            drawPicker = &lod.curvePicker;
+            drawPointCount =
+                static_cast<GLint>(lod.level(lodLevel).points.size());
+            drawCurves->cull(camera, app.width, app.height, *drawPicker);
+        }
+
+        if (useJumpFlood && !useStrokeRenderer) {
+            jumpFlood.update(app.width, app.height);
+            glViewport(0, 0, app.width, app.height);
+        }
+
+        // With closed curves only, the coarse pass also finds the fill sign
+        // of each tile
+        bool tileFill = !useScanlineSign && curves.closedFill();
+
+        // The tile pyramid draws its tiles with their own cameras, which the
+        // crossing table and the jump flood, built for the window, and the
+        // stroke renderer don't follow
+        bool pyramid = useTilePyramid && !useScanlineSign && !useJumpFlood &&
+                       !useStrokeRenderer;
+
+        // The last edited curve makes up the dynamic layer, drawn every frame
+        // over a cached field of the static layer with all other curves. The
+        // crossing table, the jump flood and the stroke renderer cover all
+        // curves at once, so they draw everything in one layer.
+        bool layered = useLayers && !useScanlineSign && !useJumpFlood &&
+                       !useStrokeRenderer && !pyramid && activeCurve >= 0 &&
+                       activeCurve < static_cast<int>(curves.curves.size());
+        bool useCoarsePass = useTileCandidates && !useJumpFlood &&
+                             !useStrokeRenderer && !pyramid;
+
+        // Coarse pass at tile resolution over the curves of a layer
+        auto coarsePass = [&](int layerCurve, bool dynamicLayer) {
+            tileCandidates.resize(app.width, app.height);
+            glBindFramebuffer(GL_FRAMEBUFFER, tileCandidates.fbo);
+            glViewport(0, 0, tileCandidates.tilesX, tileCandidates.tilesY);
+            glUseProgram(coarseProgram);
+            drawPoints->bind(coarseProgram);
+            drawCurves->bind(coarseProgram);
+            camera.bind(coarseProgram);
+            glUniform1i(glGetUniformLocation(coarseProgram, "pointCount"),
+                        drawPointCount);
+            glUniform1i(glGetUniformLocation(coarseProgram, "tileSize"),
+                        TileCandidates::kTileSize);
+            glUniform1i(glGetUniformLocation(coarseProgram, "tileFill"),
+                        tileFill ? 1 : 0);
+            glUniform1i(glGetUniformLocation(coarseProgram, "layerCurve"),
+                        layerCurve);
+            glUniform1i(glGetUniformLocation(coarseProgram, "dynamicLayer"),
+                        dynamicLayer ? 1 : 0);
+            app.drawFullscreenQuad();
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, app.width, app.height);
+        };
+
+        // Final pass over the curves of a layer through a camera onto a
+        // target of the given size, with the point to highlight, the
+        // resolution of the target relative to it and whether the coarse
+        // pass ran
+        auto curvePass = [&](const Camera& view, int width, int height,
+                             int layerCurve, bool dynamicLayer, int highlight,
+                             float scale, bool candidates) {
+            glUseProgram(shaderProgram);
+
+            // Set the mousePos uniform in the fragment shader
+            ImVec2 mousePos = ImGui::GetMousePos();
+            GLint mousePosLocation =
+                glGetUniformLocation(shaderProgram, "mousePos");
+            glUniform2f(mousePosLocation, static_cast<GLfloat>(mousePos.x),
+                        static_cast<GLfloat>(mousePos.y));
+
+            // Set the windowSize uniform in the fragment shader
+            GLint windowSizeLocation =
+                glGetUniformLocation(shaderProgram, "windowSize");
+            glUniform2f(windowSizeLocation, static_cast<GLfloat>(width),
+                        static_cast<GLfloat>(height));
+
+            // Set the nearestIndex uniform in the fragment shader
+            GLint nearestIndexLocation =
+                glGetUniformLocation(shaderProgram, "nearestIndex");
+            glUniform1i(nearestIndexLocation, lodLevel > 0 ? -1 : highlight);
+
+            // Bind the point buffer and the curve table and set their
+            // samplers
+            drawPoints->bind(shaderProgram);
+            drawCurves->bind(shaderProgram);
+            view.bind(shaderProgram);
+            glUniform1i(glGetUniformLocation(shaderProgram, "pointCount"),
+                        drawPointCount);
+
+            // Crossing table for the fill sign
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_BUFFER, crossingTextures[0]);
+            glUniform1i(glGetUniformLocation(shaderProgram, "crossingOffsets"),
+                        1);
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_BUFFER, crossingTextures[1]);
+            glUniform1i(glGetUniformLocation(shaderProgram, "crossingValues"),
+                        2);
+            glUniform1i(glGetUniformLocation(shaderProgram, "useScanlineSign"),
+                        useScanlineSign ? 1 : 0);
+
+            // Candidate lists of the coarse pass
+            glActiveTexture(GL_TEXTURE3);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, tileCandidates.texture);
+            glUniform1i(glGetUniformLocation(shaderProgram, "tileCandidates"),
+                        3);
+            glUniform1i(
+                glGetUniformLocation(shaderProgram, "useTileCandidates"),
+                candidates ? 1 : 0);
+            glUniform1i(glGetUniformLocation(shaderProgram, "tileSize"),
+                        TileCandidates::kTileSize);
+            glUniform1i(glGetUniformLocation(shaderProgram, "tileFill"),
+                        tileFill ? 1 : 0);
+
+            // Jump flood distance field
+            glActiveTexture(GL_TEXTURE4);
+            glBindTexture(GL_TEXTURE_2D, jumpFlood.texture());
+            glUniform1i(glGetUniformLocation(shaderProgram, "jumpFlood"), 4);
+            glUniform1i(glGetUniformLocation(shaderProgram, "useJumpFlood"),
+                        useJumpFlood ? 1 : 0);
+            glUniform1i(glGetUniformLocation(shaderProgram, "refineJumpFlood"),
+                        refineJumpFlood ? 1 : 0);
+            glActiveTexture(GL_TEXTURE0);
+
+            // Map the pixels of the scaled target back to window pixels
+            glUniform1f(glGetUniformLocation(shaderProgram, "renderScale"),
+                        scale);
+
+            glUniform1i(glGetUniformLocation(shaderProgram, "layerCurve"),
+                        layerCurve);
+            glUniform1i(glGetUniformLocation(shaderProgram, "dynamicLayer"),
+                        dynamicLayer ? 1 : 0);
+            // The static layer is only read by the dynamic one, never while
+            // it is drawn into
+            glActiveTexture(GL_TEXTURE11);
+            glBindTexture(GL_TEXTURE_2D,
+                          layerCurve >= 0 && dynamicLayer ? layerCache.texture
+                                                          : 0);
+            glUniform1i(glGetUniformLocation(shaderProgram, "staticLayer"),
+                        11);
+            glActiveTexture(GL_TEXTURE0);
+
+            app.drawFullscreenQuad();
+        };
+
+        // Redraw the static layer once it is stale
+        size_t curveCount = curves.curves.size();
+        int layerMode =
+            (useCoarsePass ? 1 : 0) | (tileFill ? 2 : 0) | (lodLevel << 2);
+        if (layered && !layerCache.matches(app.width, app.height, activeCurve,
+                                           curveCount, layerMode)) {
+            if (useCoarsePass) {
+                coarsePass(activeCurve, false);
+            }
+            layerCache.begin(app.width, app.height, activeCurve, curveCount,
+                             layerMode);
+            curvePass(camera, app.width, app.height, activeCurve, false, -1,
+                      1.0f, useTileCandidates);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, app.width, app.height);
+            ++layerRedraws;
+        }
+
+        // Draw the missing tiles of the view, then the curves are culled for
+        // the window again
+        if (pyramid) {
+            tilePyramid.setMode((tileFill ? 1 : 0) | (lodEnabled ? 2 : 0));
+            tilePyramid.plan(camera, app.width, app.height, missingTiles);
+            for (size_t k = 0; k < missingTiles.size(); ++k) {
+                if (!tilePyramid.beginTile(missingTiles[k])) {
+                    break;
+                }
+                Camera tileCamera = tilePyramid.tileCamera(missingTiles[k]);
+                drawCurves->cull(tileCamera, TilePyramid::kTileSize,
+                                 TilePyramid::kTileSize, *drawPicker);
+                curvePass(tileCamera, TilePyramid::kTileSize,
+                          TilePyramid::kTileSize, -1, false, -1, 1.0f, false);
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, app.width, app.height);
+            if (!missingTiles.empty()) {
+                drawCurves->cull(camera, app.width, app.height, *drawPicker);
+            }
+        }
+
+        if (useCoarsePass) {
+            coarsePass(layered ? activeCurve : -1, true);
         }
 
         glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glUseProgram(shaderProgram);
-
-        // Set the mousePos uniform in the fragment shader
-        ImVec2 mousePos = ImGui::GetMousePos();
-        GLint mousePosLocation =
-            glGetUniformLocation(shaderProgram, "mousePos");
-        glUniform2f(mousePosLocation, static_cast<GLfloat>(mousePos.x),
-                    static_cast<GLfloat>(mousePos.y));
+        // The dynamic layer is a single curve, it stays at full resolution
+        bool scaled = renderScale.scale < 1.0f && !useStrokeRenderer &&
+                      !layered && !pyramid;
+        if (scaled) {
+            scaledTarget.resize(app.width, app.height, renderScale.scale);
+            glBindFramebuffer(GL_FRAMEBUFFER, scaledTarget.fbo);
+            glViewport(0, 0, scaledTarget.width, scaledTarget.height);
+        }
 
-        // Set the windowSize uniform in the fragment shader
-        GLint windowSizeLocation =
-            glGetUniformLocation(shaderProgram, "windowSize");
-        glUniform2f(windowSizeLocation, static_cast<GLfloat>(app.width),
-                    static_cast<GLfloat>(app.height));
+        // Move the dragged point to the newest cursor position right before
+        // the curve draw. Only the point buffer and the stroke can follow
+        // this late, the passes built from the CPU biarcs catch up next frame.
+        if (lateLatch && nearestIdxWhenClicked != -1 && !pyramid &&
+            lodLevel == 0 &&
+            (useStrokeRenderer || !useScanlineSign)) {
+            double x, y;
+            glfwGetCursorPos(app.window, &x, &y);
+            size_t i = nearestIdxWhenClicked;
+            glm::dvec2 latched = camera.toWorld(glm::dvec2(x, y));
+            if (latched != pointList[i]) {
+                pointList[i] = latched;
+                tangents.update(pointList, curves, i, i);
+                curves.updateBounds(pointList, tangents.values,
+                                    i > 0 ? i - 1 : 0, i + 1);
+                size_t seams[2];
+                if (curves.seamNeighbors(i, i, seams) > 0) {
+                    size_t seam = seams[0];
+                    curves.updateBounds(pointList, tangents.values, seam,
+                                        seam);
+                    pointBuffer.update(pointList, tangents, seam, seam);
+                    pointFileWriter.markChanged(seam, seam);
+                    arcLengths.markChanged(seam, seam);
+                    if (useStrokeRenderer) {
+                        strokeRenderer.update(pointList, tangents.values,
+                                              curves, seam, seam);
+                    }
+                }
+                arcLengths.markChanged(i > 0 ? i - 1 : 0, i + 1);
+                arcLengths.update(pointList, tangents.values, curves);
+                curvePicker.update(arcLengths);
+                curveBuffer.update(curves);
+                curveBuffer.cull(camera, app.width, app.height, curvePicker);
+                pointBuffer.update(pointList, tangents, i > 0 ? i - 1 : 0,
+                                   i + 1);
+                pointFileWriter.markChanged(i > 0 ? i - 1 : 0, i + 1);
+                if (useStrokeRenderer) {
+                    strokeRenderer.update(pointList, tangents.values, curves,
+                                          i, i);
+                } else {
+                    strokeDirty = true;
+                }
+                biarcsDirty = true;
+                offsetsDirty = true;
+                lod.markChanged(glfwGetTime());
+                inputTime = glfwGetTime();
+            }
+        }
 
-        // Set the nearestIndex uniform in the fragment shader
-        GLint nearestIndexLocation =
-            glGetUniformLocation(shaderProgram, "nearestIndex");
-        glUniform1i(nearestIndexLocation, static_cast<GLint>(nearestIndex));
+        if (pyramid) {
+            tilePyramid.draw(camera, app.width, app.height);
+        } else if (useStrokeRenderer) {
+            strokeRenderer.draw(pointBuffer, camera, app.width, app.height,
+                                static_cast<int>(pointList.size()),
+                                nearestIndex);
+        } else {
+            curvePass(camera, app.width, app.height,
+                      layered ? activeCurve : -1, true, nearestIndex,
+                      scaled ? static_cast<float>(scaledTarget.width) /
+                                   static_cast<float>(app.width)
+                             : 1.0f,
+                      useTileCandidates);
+        }
+        if (scaled) {
+            scaledTarget.blitToWindow(app.width, app.height);
+            glViewport(0, 0, app.width, app.height);
+        }
 
-        // Bind the TBO to the texture unit and set it as a uniform
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_BUFFER, pointsTexture);
-        glUniform1i(glGetUniformLocation(shaderProgram, "pointsTexture"), 0);
-        glUniform1i(glGetUniformLocation(shaderProgram, "pointCount"),
-                    static_cast<GLint>(pointList.size()));
+        // Offsets over the curve at full resolution
+        if (showOffsets && offsetPoints.size() > 1) {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glUseProgram(offsetProgram);
+            offsetBuffer.bind(offsetProgram);
+            camera.bind(offsetProgram);
+            glUniform1i(glGetUniformLocation(offsetProgram, "pointCount"),
+                        static_cast<GLint>(offsetPoints.size()));
+            app.drawFullscreenQuad();
+            glDisable(GL_BLEND);
+        }
+        renderScale.endPass();
 
-        app.draw();
+        app.draw(inputTime);
     }
 
-    glDeleteBuffers(1, &tbo);
-    glDeleteTextures(1, &pointsTexture);
+    pointStream.close();
+    pointBuffer.cleanup();
+    curveBuffer.cleanup();
+    offsetBuffer.cleanup();
+    glDeleteBuffers(2, crossingTbos);
+    glDeleteTextures(2, crossingTextures);
     glDeleteProgram(shaderProgram);
+    glDeleteProgram(coarseProgram);
+    glDeleteProgram(offsetProgram);
+    tileCandidates.cleanup();
+    scaledTarget.cleanup();
+    layerCache.cleanup();
+    tilePyramid.cleanup();
+    lod.cleanup();
+    jumpFlood.cleanup();
+    strokeRenderer.cleanup();
+    renderScale.cleanup();
     app.cleanup();
 
     return 0;
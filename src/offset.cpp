@@ -0,0 +1,343 @@
+#include "offset.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <glm/gtc/constants.hpp>
+
+#include "arc_bvh.h"
+#include "parallel.h"
+
+namespace {
+
+// Fewest offset arcs a thread gets
+const size_t kChunkSize = 1 << 12;
+// The tolerances below are fractions of the size of the spline and the
+// distance, so they hold at any world scale.
+// Distance below which points are taken as the same
+const double kEpsilon = 1.e-8;
+// Offset arcs with a smaller radius vanish
+const double kMinRadius = 1.e-6;
+// Pieces closer to the spline than this fraction of the distance are
+// trimmed, which leaves room for rounding on the ones exactly at the
+// distance
+const double kTrimTolerance = 1.e-6;
+// Longest arc between two knots of the result. Knots with tangents to the
+// same circle reproduce it exactly, as long as they are not too far apart.
+const double kMaxKnotSweep = 0.5 * glm::pi<double>();
+// Turns sharper than this (about 0.1 degrees) are corners
+const double kCornerCos = 0.999998;
+// Distance between the two knots of a corner
+const double kCornerGap = 1.e-5;
+
+// Tolerances in world units
+struct Tolerances {
+    double epsilon, minRadius, cornerGap;
+
+    explicit Tolerances(double size)
+        : epsilon(kEpsilon * size),
+          minRadius(kMinRadius * size),
+          cornerGap(kCornerGap * size) {}
+};
+
+double Cross(const glm::dvec2& a, const glm::dvec2& b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+glm::dvec2 Normal(const glm::dvec2& t) { return glm::dvec2(-t.y, t.x); }
+
+// Fraction of the way from p to q of the point x on the line or circle of
+// the arc
+double ArcParameter(const Arc& arc, const glm::dvec2& x) {
+    if (arc.isLine) {
+        glm::dvec2 d = arc.q - arc.p;
+        return glm::dot(x - arc.p, d) / glm::dot(d, d);
+    }
+    glm::dvec2 pc = arc.p - arc.c, xc = x - arc.c;
+    double angle = std::atan2(Cross(pc, xc), glm::dot(pc, xc));
+    if (arc.sweep > 0.0 && angle < 0.0) {
+        angle += glm::two_pi<double>();
+    } else if (arc.sweep < 0.0 && angle > 0.0) {
+        angle -= glm::two_pi<double>();
+    }
+    return angle / arc.sweep;
+}
+
+// Part of the arc between the fractions u0 and u1
+Arc SubArc(const Arc& arc, double u0, double u1) {
+    return MakeArc(arc.pointAt(u0), arc.pointAt(u1), arc.tangentAt(u0));
+}
+
+// Arc from q back to p
+Arc Reversed(const Arc& arc) {
+    return MakeArc(arc.q, arc.p, -arc.tangentAt(1.0));
+}
+
+// Offset of an arc, false if it vanishes
+bool OffsetArc(const Arc& arc, double distance, const Tolerances& tolerances,
+               Arc& result) {
+    glm::dvec2 t0 = arc.tangentAt(0.0), t1 = arc.tangentAt(1.0);
+    if (!arc.isLine) {
+        // The normal points to the center of arcs sweeping positively
+        double radius =
+            arc.radius() - (arc.sweep > 0.0 ? distance : -distance);
+        if (radius < tolerances.minRadius) {
+            return false;
+        }
+    }
+    result = MakeArc(arc.p + distance * Normal(t0),
+                     arc.q + distance * Normal(t1), t0);
+    return true;
+}
+
+// Points where the lines or circles carrying a and b cross
+int CarrierCrossings(const Arc& a, const Arc& b, glm::dvec2 points[2]) {
+    if (a.isLine && b.isLine) {
+        glm::dvec2 da = a.q - a.p, db = b.q - b.p;
+        double den = Cross(da, db);
+        if (std::abs(den) <= 1.e-12 * glm::length(da) * glm::length(db)) {
+            return 0;
+        }
+        points[0] = a.p + Cross(b.p - a.p, db) / den * da;
+        return 1;
+    }
+    if (a.isLine || b.isLine) {
+        const Arc& line = a.isLine ? a : b;
+        const Arc& circle = a.isLine ? b : a;
+        glm::dvec2 d = line.q - line.p, f = line.p - circle.c;
+        double dd = glm::dot(d, d), fd = glm::dot(f, d);
+        double discriminant = fd * fd - dd * (glm::dot(f, f) - circle.r2);
+        if (discriminant < 0.0) {
+            return 0;
+        }
+        double root = std::sqrt(discriminant);
+        points[0] = line.p + (-fd - root) / dd * d;
+        points[1] = line.p + (-fd + root) / dd * d;
+        return 2;
+    }
+    glm::dvec2 d = b.c - a.c;
+    double distance = glm::length(d);
+    double ra = a.radius(), rb = b.radius();
+    if (distance <= 0.0 || distance > ra + rb ||
+        distance < std::abs(ra - rb)) {
+        return 0;
+    }
+    double along = (a.r2 - b.r2 + distance * distance) / (2.0 * distance);
+    double across = std::sqrt(std::max(0.0, a.r2 - along * along));
+    glm::dvec2 u = d / distance;
+    points[0] = a.c + along * u + across * Normal(u);
+    points[1] = a.c + along * u - across * Normal(u);
+    return 2;
+}
+
+// Whether x, which lies on the line or circle of the arc, is part of it,
+// and where
+bool OnArc(const Arc& arc, const glm::dvec2& x, double epsilon, double& u) {
+    u = ArcParameter(arc, x);
+    double slack = epsilon / std::max(arc.length(), epsilon);
+    if (u < -slack || u > 1.0 + slack) {
+        return false;
+    }
+    u = glm::clamp(u, 0.0, 1.0);
+    return true;
+}
+
+bool IsEndPoint(const Arc& arc, const glm::dvec2& x, double epsilon) {
+    return glm::distance(x, arc.p) < epsilon ||
+           glm::distance(x, arc.q) < epsilon;
+}
+
+// Crossings of the arcs first ... last - 1 with the arcs after them, as
+// the index of an arc and the fraction at which to split it
+void FindCrossings(const ArcBvh& bvh, size_t first, size_t last,
+                   double epsilon,
+                   std::vector<std::pair<size_t, double> >& splits) {
+    std::vector<size_t> candidates;
+    for (size_t i = first; i < last; ++i) {
+        const Arc& a = bvh.arcs[i];
+        glm::dvec2 lo, hi;
+        a.bounds(lo, hi);
+        candidates.clear();
+        bvh.overlapping(lo - epsilon, hi + epsilon, candidates);
+        for (size_t k = 0; k < candidates.size(); ++k) {
+            size_t j = candidates[k];
+            if (j <= i) {
+                continue;
+            }
+            const Arc& b = bvh.arcs[j];
+            glm::dvec2 points[2];
+            int count = CarrierCrossings(a, b, points);
+            for (int n = 0; n < count; ++n) {
+                double ua, ub;
+                // Neighbors touch at their shared end point
+                if ((IsEndPoint(a, points[n], epsilon) &&
+                     IsEndPoint(b, points[n], epsilon)) ||
+                    !OnArc(a, points[n], epsilon, ua) ||
+                    !OnArc(b, points[n], epsilon, ub)) {
+                    continue;
+                }
+                splits.push_back(std::make_pair(i, ua));
+                splits.push_back(std::make_pair(j, ub));
+            }
+        }
+    }
+}
+
+// Clear keep for the pieces first ... last - 1 that come closer to the
+// spline than the distance
+void TrimPieces(const ArcBvh& spline, const std::vector<Arc>& pieces,
+                double distance, size_t first, size_t last,
+                std::vector<char>& keep) {
+    double limit = distance * (1.0 - kTrimTolerance);
+    for (size_t i = first; i < last; ++i) {
+        keep[i] = !spline.anyCloser(pieces[i].pointAt(0.5), limit);
+    }
+}
+
+// Append an arc to the curve, which ends at its start
+void AppendArc(BiarcCurve& curve, const Arc& arc, double cornerGap) {
+    glm::dvec2 t = arc.tangentAt(0.0);
+    if (curve.points.empty()) {
+        curve.points.push_back(arc.p);
+        curve.tangents.push_back(glm::vec2(t));
+    } else if (glm::dot(glm::dvec2(curve.tangents.back()), t) < kCornerCos) {
+        curve.points.push_back(arc.p + cornerGap * t);
+        curve.tangents.push_back(glm::vec2(t));
+    }
+    int knots = arc.isLine ? 1
+                           : std::max(1, static_cast<int>(std::ceil(
+                                             std::abs(arc.sweep) /
+                                             kMaxKnotSweep)));
+    for (int k = 1; k <= knots; ++k) {
+        double u = static_cast<double>(k) / knots;
+        curve.points.push_back(k == knots ? arc.q : arc.pointAt(u));
+        curve.tangents.push_back(glm::vec2(arc.tangentAt(u)));
+    }
+}
+
+}  // namespace
+
+void OffsetSpline(const std::vector<glm::dvec2>& points,
+                  const std::vector<glm::vec2>& tangents, double distance,
+                  std::vector<BiarcCurve>& curves) {
+    curves.clear();
+    if (points.size() < 2 || distance == 0.0) {
+        return;
+    }
+
+    glm::dvec2 lo = points[0], hi = points[0];
+    for (size_t i = 1; i < points.size(); ++i) {
+        lo = glm::min(lo, points[i]);
+        hi = glm::max(hi, points[i]);
+    }
+    Tolerances tolerances(
+        std::max(std::max(hi.x - lo.x, hi.y - lo.y), std::abs(distance)));
+
+    // Arcs of the spline in the direction of travel
+    std::vector<Arc> spline;
+    spline.reserve(2 * points.size());
+    for (size_t i = 0; i + 1 < points.size(); ++i) {
+        Biarc biarc = SegmentBiarc(points, tangents, i);
+        Arc arcs[2] = {biarc.a, Reversed(biarc.b)};
+        for (int k = 0; k < 2; ++k) {
+            if (glm::distance(arcs[k].p, arcs[k].q) > tolerances.epsilon) {
+                spline.push_back(arcs[k]);
+            }
+        }
+    }
+
+    // Raw offset, with lines across the gaps left by vanished arcs
+    std::vector<Arc> raw;
+    raw.reserve(spline.size());
+    for (size_t i = 0; i < spline.size(); ++i) {
+        Arc arc;
+        if (!OffsetArc(spline[i], distance, tolerances, arc)) {
+            continue;
+        }
+        if (!raw.empty() &&
+            glm::distance(raw.back().q, arc.p) > tolerances.epsilon) {
+            glm::dvec2 p = raw.back().q;
+            raw.push_back(MakeArc(p, arc.p, glm::normalize(arc.p - p)));
+        }
+        raw.push_back(arc);
+    }
+
+    // Split the raw offset where it crosses itself
+    ArcBvh rawBvh;
+    rawBvh.build(raw);
+    size_t chunks = ChunkCount(raw.size(), kChunkSize);
+    std::vector<std::vector<std::pair<size_t, double> > > chunkSplits(chunks);
+    ParallelChunks(raw.size(), chunks,
+                   [&](size_t first, size_t last, size_t chunk) {
+        FindCrossings(rawBvh, first, last, tolerances.epsilon,
+                      chunkSplits[chunk]);
+    });
+    std::vector<std::pair<size_t, double> > splits;
+    for (size_t k = 0; k < chunks; ++k) {
+        splits.insert(splits.end(), chunkSplits[k].begin(),
+                      chunkSplits[k].end());
+    }
+    std::sort(splits.begin(), splits.end());
+    std::vector<Arc> pieces;
+    pieces.reserve(raw.size() + splits.size());
+    for (size_t i = 0, k = 0; i < raw.size(); ++i) {
+        double u0 = 0.0, length = raw[i].length();
+        for (; k <= splits.size(); ++k) {
+            bool split = k < splits.size() && splits[k].first == i;
+            double u1 = split ? splits[k].second : 1.0;
+            if ((u1 - u0) * length > tolerances.epsilon) {
+                pieces.push_back(u0 == 0.0 && u1 == 1.0
+                                     ? raw[i]
+                                     : SubArc(raw[i], u0, u1));
+                u0 = u1;
+            }
+            if (!split) {
+                break;
+            }
+        }
+    }
+
+    // Trim the pieces that come too close to the spline
+    ArcBvh splineBvh;
+    splineBvh.build(spline);
+    std::vector<char> keep(pieces.size());
+    ParallelChunks(pieces.size(), ChunkCount(pieces.size(), kChunkSize),
+                   [&](size_t first, size_t last, size_t) {
+        TrimPieces(splineBvh, pieces, std::abs(distance), first, last, keep);
+    });
+
+    // Chain the rest, a trimmed loop leaves the pieces before and after it
+    // meeting at the crossing. Slivers next to crossings would only add
+    // knots going back and forth.
+    glm::dvec2 start(0.0), end(0.0);
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        if (!keep[i] || pieces[i].length() <= tolerances.cornerGap) {
+            continue;
+        }
+        if (curves.empty()) {
+            start = pieces[i].p;
+            curves.push_back(BiarcCurve());
+        } else if (glm::distance(end, pieces[i].p) > tolerances.cornerGap) {
+            curves.push_back(BiarcCurve());
+        }
+        AppendArc(curves.back(), pieces[i], tolerances.cornerGap);
+        end = pieces[i].q;
+    }
+    if (curves.empty() || glm::distance(end, start) > tolerances.cornerGap) {
+        return;
+    }
+    if (curves.size() == 1) {
+        curves[0].closed = true;
+        return;
+    }
+    // The last curve continues with the first
+    BiarcCurve& last = curves.back();
+    BiarcCurve& first = curves.front();
+    last.points.insert(last.points.end(), first.points.begin() + 1,
+                       first.points.end());
+    last.tangents.insert(last.tangents.end(), first.tangents.begin() + 1,
+                         first.tangents.end());
+    std::swap(first, last);
+    curves.pop_back();
+}
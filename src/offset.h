@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "biarc.h"
+
+// Offset curves at the given distance of the biarc spline through the
+// points with the given unit tangents. Positive distances offset to the
+// side of the normal (-t.y, t.x), negative ones to the other side.
+//
+// The offset of an arc is the arc around the same center with the radius
+// changed by the distance, so the result is exact. Arcs whose radius drops
+// to zero vanish, and their neighbors are joined by a line. Where the raw
+// offset crosses itself, it is split at the crossings, found through a
+// bounding volume hierarchy over its arcs. Pieces that come closer to the
+// spline than the distance are trimmed, and the rest is chained into
+// curves. The crossing search and the trimming run on one thread per core
+// for long splines.
+void OffsetSpline(const std::vector<glm::dvec2>& points,
+                  const std::vector<glm::vec2>& tangents, double distance,
+                  std::vector<BiarcCurve>& curves);
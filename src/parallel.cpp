@@ -0,0 +1,23 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+size_t ChunkCount(size_t count, size_t minChunk) {
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    return std::max<size_t>(1, std::min(workers, count / minChunk));
+}
+
+void ParallelChunks(size_t count, size_t chunks,
+                    const std::function<void(size_t, size_t, size_t)>& work) {
+    std::vector<std::thread> threads;
+    for (size_t k = 1; k < chunks; ++k) {
+        threads.push_back(
+            std::thread(work, count * k / chunks, count * (k + 1) / chunks, k));
+    }
+    work(0, count / chunks, 0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
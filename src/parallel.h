@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+// Number of chunks to split count items into: one per core at most, and
+// none with fewer than minChunk items
+size_t ChunkCount(size_t count, size_t minChunk);
+
+// Run work(first, last, k) for chunks k = 0 ... chunks - 1, where chunk k
+// covers the items count * k / chunks ... count * (k + 1) / chunks - 1.
+// Each chunk after the first gets a thread of its own, the first one runs
+// on the calling thread, and the call returns once all of them are done.
+void ParallelChunks(size_t count, size_t chunks,
+                    const std::function<void(size_t, size_t, size_t)>& work);
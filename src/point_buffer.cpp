@@ -0,0 +1,458 @@
+#include "point_buffer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define STRINGIFY(x) #x
+#define TO_STRING(x) STRINGIFY(x)
+
+const char* const kPointFetchSource =
+    "\n#define POINT_BLOCK_SIZE " TO_STRING(POINT_BLOCK_SIZE) R"(
+    uniform samplerBuffer pointsTexture;
+    // Origin and step of every block of POINT_BLOCK_SIZE points
+    uniform samplerBuffer blockOrigins;
+
+    // Compact encoding
+    uniform bool compactPoints;
+    uniform isamplerBuffer compactPointsTexture;
+
+    // First point and first slot of every page, once points have been
+    // inserted or erased in the middle
+    uniform bool pagedPoints;
+    uniform isamplerBuffer pointPages;
+    uniform int pointPageCount;
+
+    int point_slot(int i) {
+        if (!pagedPoints) {
+            return i;
+        }
+        // Last page that starts at or before i
+        int lo = 0;
+        int hi = pointPageCount - 1;
+        while (lo < hi) {
+            int mid = (lo + hi + 1) / 2;
+            if (texelFetch(pointPages, mid).x <= i) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        ivec2 page = texelFetch(pointPages, lo).xy;
+        return page.y + i - page.x;
+    }
+
+    vec4 fetch_point(int i) {
+        int slot = point_slot(i);
+        // The offset from the block origin is small, only the origin needs
+        // the split view origin
+        vec4 block = texelFetch(blockOrigins, slot / POINT_BLOCK_SIZE);
+        if (!compactPoints) {
+            vec4 point = texelFetch(pointsTexture, slot);
+            return vec4(to_view(block.xy) + point.xy * viewScale, point.zw);
+        }
+        vec4 point = vec4(texelFetch(compactPointsTexture, slot));
+        return vec4(to_view(block.xy) + point.xy * (block.z * viewScale),
+                    point.zw / 32767.0);
+    }
+)";
+
+namespace {
+
+const double kMaxOffset = 32767.0;
+// Room in world units for points that move out of the bounds of their
+// block before it has to be fitted again
+const double kBlockMargin = 128.0;
+
+// The origin is the float nearest to the center of the points, so that
+// the offsets taken from it in doubles are exact relative to the float
+// the shader gets
+glm::vec4 FitBlock(const std::vector<glm::dvec2>& points, size_t begin,
+                   size_t end) {
+    glm::dvec2 lo(points[begin]), hi(points[begin]);
+    for (size_t i = begin + 1; i < end; ++i) {
+        lo = glm::min(lo, points[i]);
+        hi = glm::max(hi, points[i]);
+    }
+    glm::vec2 origin(0.5 * (lo + hi));
+    glm::dvec2 extent = glm::max(hi - glm::dvec2(origin),
+                                 glm::dvec2(origin) - lo);
+    double step =
+        (std::max(extent.x, extent.y) + kBlockMargin) / kMaxOffset;
+    return glm::vec4(origin.x, origin.y, static_cast<float>(step), 0.0f);
+}
+
+glm::dvec2 Offset(const glm::vec4& block, const glm::dvec2& point) {
+    return point - glm::dvec2(block.x, block.y);
+}
+
+bool Fits(const glm::vec4& block, const glm::dvec2& point) {
+    if (block.z == 0.0f) {
+        return false;
+    }
+    glm::dvec2 offset = Offset(block, point) / double(block.z);
+    return std::abs(offset.x) <= kMaxOffset && std::abs(offset.y) <= kMaxOffset;
+}
+
+GLshort Quantize(double value) {
+    return static_cast<GLshort>(
+        std::max(-kMaxOffset, std::min(kMaxOffset, std::round(value))));
+}
+
+void Release(GLuint buffer) {
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, 0, NULL, GL_DYNAMIC_DRAW);
+}
+
+}  // namespace
+
+void PointBuffer::init() {
+    glGenBuffers(1, &tbo);
+    glGenTextures(1, &texture);
+    glBindBuffer(GL_TEXTURE_BUFFER, tbo);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, tbo);
+
+    glGenBuffers(1, &compactTbo);
+    glGenTextures(1, &compactTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, compactTbo);
+    glBindTexture(GL_TEXTURE_BUFFER, compactTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA16I, compactTbo);
+
+    glGenBuffers(1, &blockTbo);
+    glGenTextures(1, &blockTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, blockTbo);
+    glBindTexture(GL_TEXTURE_BUFFER, blockTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, blockTbo);
+
+    glGenBuffers(1, &pageTbo);
+    glGenTextures(1, &pageTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, pageTbo);
+    glBindTexture(GL_TEXTURE_BUFFER, pageTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32I, pageTbo);
+}
+
+void PointBuffer::rebuild(const std::vector<glm::dvec2>& points,
+                          const Tangents& tangents) {
+    capacity = 0;
+    count = 0;
+    pages.clear();
+    blockCount = 0;
+    freeBlocks.clear();
+    paged = false;
+    blocks.clear();
+    // Release the storage of the encoding that is not in use, the rest
+    // is allocated again
+    Release(compact ? tbo : compactTbo);
+    Release(blockTbo);
+    Release(pageTbo);
+    if (!points.empty()) {
+        update(points, tangents, 0, points.size() - 1);
+    }
+}
+
+void PointBuffer::update(const std::vector<glm::dvec2>& points,
+                         const Tangents& tangents, size_t first, size_t last) {
+    size_t oldCount = count;
+    bool pagesChanged = resize(points.size());
+    if (points.empty()) {
+        return;
+    }
+    upload(points, tangents, std::min(first, oldCount), last);
+    if (paged && pagesChanged) {
+        uploadPages();
+    }
+}
+
+void PointBuffer::insert(const std::vector<glm::dvec2>& points,
+                         const Tangents& tangents, size_t i, size_t n) {
+    if (n == 0) {
+        return;
+    }
+    if (i >= count) {
+        update(points, tangents, i > 0 ? i - 1 : 0, points.size() - 1);
+        return;
+    }
+    paged = true;
+    size_t k = pageAt(i);
+    size_t start = pages[k].x;
+    size_t total = pageEnd(k) - start + n;
+    for (size_t j = k + 1; j < pages.size(); ++j) {
+        pages[j].x += static_cast<GLint>(n);
+    }
+    count += n;
+    // The rest of the page moves up within its block if there is room,
+    // otherwise the page is split evenly into pages with blocks of their
+    // own, and the first one starts over at the beginning of its block
+    size_t first = i;
+    if (total > pageRoom(k)) {
+        size_t parts = total / kBlockSize + 1;
+        pages[k].y -= pages[k].y % kBlockSize;
+        std::vector<glm::ivec2> split;
+        for (size_t p = 1; p < parts; ++p) {
+            split.push_back(
+                glm::ivec2(static_cast<GLint>(start + total * p / parts),
+                           static_cast<GLint>(allocateBlock() * kBlockSize)));
+        }
+        pages.insert(pages.begin() + k + 1, split.begin(), split.end());
+        first = start;
+    }
+    upload(points, tangents, first > 0 ? first - 1 : 0,
+           std::max(start + total - 1, i + n));
+    uploadPages();
+}
+
+void PointBuffer::erase(const std::vector<glm::dvec2>& points,
+                        const Tangents& tangents, size_t i, size_t n) {
+    if (n == 0) {
+        return;
+    }
+    if (i + n >= count) {
+        update(points, tangents, i > 0 ? i - 1 : 0, i > 0 ? i - 1 : 0);
+        return;
+    }
+    paged = true;
+    size_t end = i + n;
+    size_t k = pageAt(i), e = pageAt(end - 1);
+    size_t last = i;
+    if (k == e) {
+        // The rest of the page moves down within its block
+        last = std::max(last, pageEnd(k) - n - 1);
+    } else {
+        // The last page keeps its points after the erased ones where they
+        // are, the pages in between are dropped
+        size_t skipped = end - pages[e].x;
+        pages[e] += glm::ivec2(static_cast<GLint>(skipped));
+        for (size_t j = k + 1; j < e; ++j) {
+            freeBlock(pages[j].y / kBlockSize);
+        }
+        pages.erase(pages.begin() + k + 1, pages.begin() + e);
+    }
+    for (size_t j = k + 1; j < pages.size(); ++j) {
+        pages[j].x -= static_cast<GLint>(n);
+    }
+    count -= n;
+    for (size_t j = std::min(k + 2, pages.size()); j-- > k;) {
+        if (pageEnd(j) == static_cast<size_t>(pages[j].x)) {
+            freeBlock(pages[j].y / kBlockSize);
+            pages.erase(pages.begin() + j);
+        }
+    }
+    // Merge the page before the gap with the next one if they fit into one
+    // block, so that erasing does not leave ever smaller pages behind
+    size_t a = pageAt(i > 0 ? i - 1 : 0);
+    if (a + 1 < pages.size() &&
+        pageEnd(a + 1) - pages[a].x <= pageRoom(a)) {
+        last = std::max(last, pageEnd(a + 1) - 1);
+        freeBlock(pages[a + 1].y / kBlockSize);
+        pages.erase(pages.begin() + a + 1);
+    }
+    upload(points, tangents, i > 0 ? i - 1 : 0, last);
+    uploadPages();
+}
+
+size_t PointBuffer::pageAt(size_t i) const {
+    return std::upper_bound(pages.begin(), pages.end(), i,
+                            [](size_t i, const glm::ivec2& page) {
+                                return i < static_cast<size_t>(page.x);
+                            }) -
+           pages.begin() - 1;
+}
+
+size_t PointBuffer::pageEnd(size_t k) const {
+    return k + 1 < pages.size() ? pages[k + 1].x : count;
+}
+
+size_t PointBuffer::pageRoom(size_t k) const {
+    return kBlockSize - pages[k].y % kBlockSize;
+}
+
+size_t PointBuffer::allocateBlock() {
+    size_t block = blockCount;
+    if (freeBlocks.empty()) {
+        ++blockCount;
+    } else {
+        block = freeBlocks.back();
+        freeBlocks.pop_back();
+    }
+    blocks.resize(blockCount);
+    blocks[block] = glm::vec4(0.0f);
+    return block;
+}
+
+void PointBuffer::freeBlock(size_t block) {
+    if (block + 1 == blockCount) {
+        --blockCount;
+    } else {
+        freeBlocks.push_back(block);
+    }
+}
+
+bool PointBuffer::resize(size_t newCount) {
+    bool changed = false;
+    while (!pages.empty() && static_cast<size_t>(pages.back().x) >= newCount) {
+        freeBlock(pages.back().y / kBlockSize);
+        pages.pop_back();
+        changed = true;
+    }
+    count = std::min(count, newCount);
+    // Fill the block of the last page, then start new ones
+    while (count < newCount) {
+        size_t last = pages.size() - 1;
+        if (pages.empty() || count - pages[last].x == pageRoom(last)) {
+            pages.push_back(
+                glm::ivec2(static_cast<GLint>(count),
+                           static_cast<GLint>(allocateBlock() * kBlockSize)));
+            changed = true;
+            last = pages.size() - 1;
+        }
+        count = std::min(newCount, pages[last].x + pageRoom(last));
+    }
+    return changed;
+}
+
+void PointBuffer::upload(const std::vector<glm::dvec2>& points,
+                         const Tangents& tangents, size_t first, size_t last) {
+    size_t needed = blockCount * kBlockSize;
+    if (needed > capacity) {
+        capacity = std::max(needed, 2 * capacity);
+        if (compact) {
+            glBindBuffer(GL_TEXTURE_BUFFER, compactTbo);
+            glBufferData(GL_TEXTURE_BUFFER, capacity * 4 * sizeof(GLshort),
+                         NULL, GL_DYNAMIC_DRAW);
+        } else {
+            glBindBuffer(GL_TEXTURE_BUFFER, tbo);
+            glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(glm::vec4),
+                         NULL, GL_DYNAMIC_DRAW);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, blockTbo);
+        glBufferData(GL_TEXTURE_BUFFER,
+                     capacity / kBlockSize * sizeof(glm::vec4), NULL,
+                     GL_DYNAMIC_DRAW);
+        first = 0;
+        last = count - 1;
+    }
+    uploadRange(points, tangents, first, last);
+}
+
+void PointBuffer::uploadRange(const std::vector<glm::dvec2>& points,
+                              const Tangents& tangents, size_t first,
+                              size_t last) {
+    if (first >= count) {
+        return;
+    }
+    last = std::min(last, count - 1);
+
+    // Points in consecutive slots go up together
+    std::vector<glm::vec4> records;
+    std::vector<GLshort> encoded;
+    size_t runSlot = 0, runLength = 0;
+    auto flush = [&]() {
+        if (compact && runLength > 0) {
+            glBindBuffer(GL_TEXTURE_BUFFER, compactTbo);
+            glBufferSubData(GL_TEXTURE_BUFFER, runSlot * 4 * sizeof(GLshort),
+                            encoded.size() * sizeof(GLshort), encoded.data());
+        } else if (runLength > 0) {
+            glBindBuffer(GL_TEXTURE_BUFFER, tbo);
+            glBufferSubData(GL_TEXTURE_BUFFER, runSlot * sizeof(glm::vec4),
+                            records.size() * sizeof(glm::vec4),
+                            records.data());
+        }
+        records.clear();
+        encoded.clear();
+        runLength = 0;
+    };
+
+    size_t firstBlock = blockCount, lastBlock = 0;
+    for (size_t k = pageAt(first);
+         k < pages.size() && static_cast<size_t>(pages[k].x) <= last; ++k) {
+        size_t start = pages[k].x, end = pageEnd(k);
+        size_t begin = std::max(first, start), stop = std::min(last + 1, end);
+        size_t block = pages[k].y / kBlockSize;
+        // A block is fitted again as a whole once one of its points leaves
+        // it
+        bool fits = true;
+        for (size_t i = begin; fits && i < stop; ++i) {
+            fits = Fits(blocks[block], points[i]);
+        }
+        if (!fits) {
+            blocks[block] = FitBlock(points, start, end);
+            begin = start;
+            stop = end;
+        }
+        firstBlock = std::min(firstBlock, block);
+        lastBlock = std::max(lastBlock, block);
+        size_t slot = pages[k].y + (begin - start);
+        if (slot != runSlot + runLength) {
+            flush();
+            runSlot = slot;
+        }
+        for (size_t i = begin; i < stop; ++i) {
+            glm::dvec2 offset = Offset(blocks[block], points[i]);
+            if (!compact) {
+                records.push_back(
+                    glm::vec4(glm::vec2(offset), tangents.values[i]));
+                continue;
+            }
+            offset /= double(blocks[block].z);
+            encoded.push_back(Quantize(offset.x));
+            encoded.push_back(Quantize(offset.y));
+            encoded.push_back(Quantize(tangents.values[i].x * kMaxOffset));
+            encoded.push_back(Quantize(tangents.values[i].y * kMaxOffset));
+        }
+        runLength += stop - begin;
+    }
+    flush();
+
+    if (firstBlock <= lastBlock) {
+        glBindBuffer(GL_TEXTURE_BUFFER, blockTbo);
+        glBufferSubData(GL_TEXTURE_BUFFER, firstBlock * sizeof(glm::vec4),
+                        (lastBlock - firstBlock + 1) * sizeof(glm::vec4),
+                        &blocks[firstBlock]);
+    }
+}
+
+void PointBuffer::uploadPages() {
+    glBindBuffer(GL_TEXTURE_BUFFER, pageTbo);
+    glBufferData(GL_TEXTURE_BUFFER, pages.size() * sizeof(glm::ivec2),
+                 pages.data(), GL_DYNAMIC_DRAW);
+}
+
+void PointBuffer::bind(GLuint program) const {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_BUFFER, compactTexture);
+    glActiveTexture(GL_TEXTURE6);
+    glBindTexture(GL_TEXTURE_BUFFER, blockTexture);
+    glActiveTexture(GL_TEXTURE7);
+    glBindTexture(GL_TEXTURE_BUFFER, pageTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(program, "pointsTexture"), 0);
+    glUniform1i(glGetUniformLocation(program, "compactPointsTexture"), 5);
+    glUniform1i(glGetUniformLocation(program, "blockOrigins"), 6);
+    glUniform1i(glGetUniformLocation(program, "pointPages"), 7);
+    glUniform1i(glGetUniformLocation(program, "compactPoints"),
+                compact ? 1 : 0);
+    glUniform1i(glGetUniformLocation(program, "pagedPoints"), paged ? 1 : 0);
+    glUniform1i(glGetUniformLocation(program, "pointPageCount"),
+                static_cast<GLint>(pages.size()));
+}
+
+size_t PointBuffer::gpuBytes() const {
+    size_t pageBytes = paged ? pages.size() * sizeof(glm::ivec2) : 0;
+    size_t blockBytes = capacity / kBlockSize * sizeof(glm::vec4);
+    size_t pointBytes = compact ? capacity * 4 * sizeof(GLshort)
+                                : capacity * sizeof(glm::vec4);
+    return pointBytes + blockBytes + pageBytes;
+}
+
+void PointBuffer::cleanup() {
+    glDeleteBuffers(1, &tbo);
+    glDeleteTextures(1, &texture);
+    glDeleteBuffers(1, &compactTbo);
+    glDeleteTextures(1, &compactTexture);
+    glDeleteBuffers(1, &blockTbo);
+    glDeleteTextures(1, &blockTexture);
+    glDeleteBuffers(1, &pageTbo);
+    glDeleteTextures(1, &pageTexture);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "tangents.h"
+
+// Points per block of the compact encoding, a macro so that the shader
+// source can spell it out
+#define POINT_BLOCK_SIZE 256
+
+// GLSL declaring the point samplers and fetch_point(i), which returns the
+// position in window pixels in xy and the unit tangent in zw in either
+// encoding. Goes after kViewSource.
+extern const char* const kPointFetchSource;
+
+// GPU copy of the points and their unit tangents as a buffer texture, so the
+// shader needs two texel fetches per segment and no normalization. The
+// buffers grow geometrically, and edits only upload the changed range.
+//
+// The points are kept in doubles on the CPU. On the GPU each block of
+// kBlockSize points has its own float origin and step fitted to its points,
+// and a point is stored as its offset from that origin, taken in doubles,
+// so precision follows the extent of the block rather than its distance
+// from the world origin. The shaders add the block origin through the split
+// view origin of the camera. The default encoding is RGBA32F with the
+// offset in xy and the tangent in zw. The compact one is RGBA16I, with the
+// offset in steps of the block and the tangent as a signed normalized
+// value, which halves memory and fetch bandwidth.
+//
+// The points are stored in pages, runs of consecutive points that each lie
+// in one block. Until a point is inserted or erased in the middle, page k
+// holds points k * kBlockSize ... in block k and the shader indexes the
+// points directly. After that the pages can be partly filled and in any
+// block, and the shader finds the page of a point by a binary search in a
+// table of the first point and slot of every page. An insert or erase then
+// only uploads the pages it touches and the page table, not the points
+// after it.
+struct PointBuffer {
+    static const size_t kBlockSize = POINT_BLOCK_SIZE;
+
+    bool compact = false;
+
+    void init();
+    void rebuild(const std::vector<glm::dvec2>& points,
+                 const Tangents& tangents);
+    // Upload the points first ... last. Points appended to or removed from
+    // the end are taken over, too.
+    void update(const std::vector<glm::dvec2>& points,
+                const Tangents& tangents, size_t first, size_t last);
+    // Points i ... i + count - 1 have been inserted into the points, or
+    // count points at i have been erased. Uploads the pages around i,
+    // including the tangents of the neighbors.
+    void insert(const std::vector<glm::dvec2>& points,
+                const Tangents& tangents, size_t i, size_t count);
+    void erase(const std::vector<glm::dvec2>& points, const Tangents& tangents,
+               size_t i, size_t count);
+    // Bind the textures to units 0, 5, 6 and 7 and set the samplers of the
+    // program in use
+    void bind(GLuint program) const;
+    size_t gpuBytes() const;
+    void cleanup();
+
+   private:
+    GLuint tbo, texture;
+    GLuint compactTbo, compactTexture;
+    GLuint blockTbo, blockTexture;
+    GLuint pageTbo, pageTexture;
+    // Points the buffers have room for, a multiple of kBlockSize
+    size_t capacity = 0;
+    size_t count = 0;
+    // First point and first slot of every page in point order. A page ends
+    // where the next one starts and may start anywhere in its block.
+    std::vector<glm::ivec2> pages;
+    // Blocks in use or free, and the free ones
+    size_t blockCount = 0;
+    std::vector<size_t> freeBlocks;
+    // Whether the pages differ from the blocks, so the shader needs the
+    // page table
+    bool paged = false;
+    // Origin in xy and step in z of every block, with a zero step for
+    // blocks that have not been fitted yet
+    std::vector<glm::vec4> blocks;
+
+    size_t pageAt(size_t i) const;
+    size_t pageEnd(size_t k) const;
+    // Slots left in the block of page k after its first slot
+    size_t pageRoom(size_t k) const;
+    size_t allocateBlock();
+    void freeBlock(size_t block);
+    // Add or drop pages at the end for a new point count, true if the pages
+    // changed
+    bool resize(size_t newCount);
+    // Grow the buffers to the blocks in use and upload everything if they
+    // had to grow, otherwise upload the points first ... last
+    void upload(const std::vector<glm::dvec2>& points,
+                const Tangents& tangents, size_t first, size_t last);
+    void uploadRange(const std::vector<glm::dvec2>& points,
+                     const Tangents& tangents, size_t first, size_t last);
+    void uploadPages();
+};
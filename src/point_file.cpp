@@ -0,0 +1,373 @@
+#include "point_file.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char kMagic[8] = {'E', 'C', 'U', 'R', 'V', 'E', 'S', '\0'};
+const size_t kMinCapacity = 1024;
+// Records per fwrite when writing whole files
+const size_t kChunkSize = 1 << 16;
+
+// Older headers end before the curve table offset
+size_t RecordsOffset(uint32_t version = kPointFileVersion) {
+    return version >= 4 ? sizeof(PointFileHeader)
+                        : offsetof(PointFileHeader, curvesOffset);
+}
+
+size_t RecordSize(uint32_t version) {
+    return version >= 3 ? sizeof(PointFileRecord) : sizeof(glm::vec4);
+}
+
+size_t PinnedOffset(size_t capacity, uint32_t version = kPointFileVersion) {
+    return RecordsOffset(version) + capacity * RecordSize(version);
+}
+
+// End of the points, where the curve table starts in older files and the
+// first place for it in current ones
+size_t FileSize(size_t capacity, uint32_t version = kPointFileVersion) {
+    return PinnedOffset(capacity, version) + capacity * sizeof(glm::vec2);
+}
+
+bool Seek(FILE* file, size_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+// Write the records and pinned tangents of points first ... end - 1
+bool WriteRange(FILE* file, size_t capacity,
+                const std::vector<glm::dvec2>& points, const Tangents& tangents,
+                size_t first, size_t end) {
+    std::vector<PointFileRecord> records;
+    for (size_t begin = first; begin < end; begin += kChunkSize) {
+        size_t chunkEnd = std::min(end, begin + kChunkSize);
+        records.clear();
+        for (size_t i = begin; i < chunkEnd; ++i) {
+            PointFileRecord record;
+            record.point[0] = points[i].x;
+            record.point[1] = points[i].y;
+            record.tangent[0] = tangents.values[i].x;
+            record.tangent[1] = tangents.values[i].y;
+            records.push_back(record);
+        }
+        if (!Seek(file, RecordsOffset() + begin * sizeof(PointFileRecord)) ||
+            fwrite(records.data(), sizeof(PointFileRecord), records.size(),
+                   file) != records.size()) {
+            return false;
+        }
+    }
+    if (first < end &&
+        (!Seek(file, PinnedOffset(capacity) + first * sizeof(glm::vec2)) ||
+         fwrite(&tangents.pinned[first], sizeof(glm::vec2), end - first,
+                file) != end - first)) {
+        return false;
+    }
+    return true;
+}
+
+size_t CurvesSize(const CurveTable& curves) {
+    return sizeof(uint64_t) + curves.curves.size() * sizeof(PointFileCurve);
+}
+
+bool WriteCurves(FILE* file, size_t offset, const CurveTable& curves) {
+    std::vector<PointFileCurve> entries(curves.curves.size());
+    for (size_t c = 0; c < entries.size(); ++c) {
+        const Curve& curve = curves.curves[c];
+        PointFileCurve& entry = entries[c];
+        entry.first = curve.first;
+        entry.count = curve.count;
+        entry.closed = curve.closed ? 1 : 0;
+        entry.reserved = 0;
+        entry.color[0] = curve.color.r;
+        entry.color[1] = curve.color.g;
+        entry.color[2] = curve.color.b;
+        entry.color[3] = curve.color.a;
+    }
+    uint64_t count = entries.size();
+    return Seek(file, offset) &&
+           fwrite(&count, sizeof(count), 1, file) == 1 &&
+           fwrite(entries.data(), sizeof(PointFileCurve), entries.size(),
+                  file) == entries.size();
+}
+
+// Push the writes so far to the disk
+bool Sync(FILE* file) {
+    if (fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool WriteHeader(FILE* file, size_t count, size_t capacity,
+                 size_t curvesOffset, TangentMethod method) {
+    PointFileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kPointFileVersion;
+    header.tangentMethod = static_cast<uint32_t>(method);
+    header.count = count;
+    header.capacity = capacity;
+    header.curvesOffset = curvesOffset;
+    return Seek(file, 0) && fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+}  // namespace
+
+bool PointFileMapping::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                       OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        fprintf(stderr, "Cannot open %s\n", path.c_str());
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    size = static_cast<size_t>(fileSize.QuadPart);
+    mapping = size > 0 ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0,
+                                            NULL)
+                       : NULL;
+    data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open %s\n", path.c_str());
+        return false;
+    }
+    struct stat info;
+    fstat(fd, &info);
+    size = static_cast<size_t>(info.st_size);
+    data = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0)
+                    : MAP_FAILED;
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        data = nullptr;
+    }
+#endif
+    if (!data) {
+        fprintf(stderr, "Cannot map %s\n", path.c_str());
+        close();
+        return false;
+    }
+
+    header = static_cast<const PointFileHeader*>(data);
+    bool valid = size >= RecordsOffset(1) &&
+                 std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0 &&
+                 header->version >= 1 && header->version <= kPointFileVersion;
+    uint32_t version = valid ? header->version : kPointFileVersion;
+    valid = valid && size >= RecordsOffset(version) &&
+            header->count <= header->capacity &&
+            header->capacity <= (size - RecordsOffset(version)) /
+                                    (RecordSize(version) + sizeof(glm::vec2)) &&
+            header->tangentMethod < kTangentMethodCount;
+    const char* bytes = static_cast<const char*>(data);
+    size_t capacity = valid ? static_cast<size_t>(header->capacity) : 0;
+    size_t curvesOffset = FileSize(capacity, version);
+    if (valid && version >= 4) {
+        valid = header->curvesOffset >= curvesOffset &&
+                header->curvesOffset <= size;
+        curvesOffset = static_cast<size_t>(header->curvesOffset);
+    }
+    if (valid && version >= 2) {
+        // The curves have to cover the points in order
+        size_t tail = size - curvesOffset;
+        uint64_t count = 0;
+        if (tail >= sizeof(count)) {
+            std::memcpy(&count, bytes + curvesOffset, sizeof(count));
+        }
+        valid = tail >= sizeof(count) &&
+                count <= (tail - sizeof(count)) / sizeof(PointFileCurve);
+        curves = reinterpret_cast<const PointFileCurve*>(
+            bytes + curvesOffset + sizeof(count));
+        curveCount = static_cast<size_t>(count);
+        uint64_t next = 0;
+        for (size_t c = 0; valid && c < curveCount; ++c) {
+            valid = curves[c].first == next &&
+                    curves[c].count <= header->count - next;
+            next += curves[c].count;
+        }
+        valid = valid && next == header->count;
+    }
+    if (!valid) {
+        fprintf(stderr, "%s is not a point file of version 1 to %u\n",
+                path.c_str(), kPointFileVersion);
+        close();
+        return false;
+    }
+    if (version >= 3) {
+        records = reinterpret_cast<const PointFileRecord*>(
+            bytes + RecordsOffset(version));
+    } else {
+        floatRecords = reinterpret_cast<const glm::vec4*>(
+            bytes + RecordsOffset(version));
+    }
+    pinned = reinterpret_cast<const glm::vec2*>(
+        bytes + PinnedOffset(capacity, version));
+    return true;
+}
+
+glm::dvec2 PointFileMapping::point(size_t i) const {
+    if (records) {
+        return glm::dvec2(records[i].point[0], records[i].point[1]);
+    }
+    return glm::dvec2(floatRecords[i].x, floatRecords[i].y);
+}
+
+glm::vec2 PointFileMapping::tangent(size_t i) const {
+    if (records) {
+        return glm::vec2(records[i].tangent[0], records[i].tangent[1]);
+    }
+    return glm::vec2(floatRecords[i].z, floatRecords[i].w);
+}
+
+void PointFileMapping::close() {
+#ifdef _WIN32
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+    if (file) {
+        CloseHandle(file);
+    }
+    file = mapping = nullptr;
+#else
+    if (data) {
+        munmap(data, size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+    header = nullptr;
+    records = nullptr;
+    floatRecords = nullptr;
+    pinned = nullptr;
+    curves = nullptr;
+    curveCount = 0;
+}
+
+void PointFileWriter::markChanged(size_t first, size_t last) {
+    dirtyFirst = dirty ? std::min(dirtyFirst, first) : first;
+    dirtyLast = dirty ? std::max(dirtyLast, last) : last;
+    dirty = true;
+}
+
+void PointFileWriter::adopt(const std::string& path,
+                            const PointFileMapping& mapping) {
+    const PointFileHeader& header = *mapping.header;
+    // Older files are rewritten on the next save
+    bool current = header.version == kPointFileVersion;
+    savedPath = current ? path : std::string();
+    savedCount = static_cast<size_t>(header.count);
+    capacity = static_cast<size_t>(header.capacity);
+    curvesOffset = current ? static_cast<size_t>(header.curvesOffset) : 0;
+    curvesSize = sizeof(uint64_t) + mapping.curveCount * sizeof(PointFileCurve);
+    dirty = false;
+}
+
+bool PointFileWriter::save(const std::string& path,
+                           const std::vector<glm::dvec2>& points,
+                           const Tangents& tangents,
+                           const CurveTable& curves) {
+    if (path != savedPath || points.size() > capacity ||
+        points.size() < savedCount) {
+        return rewrite(path, points, tangents, curves);
+    }
+    FILE* file = fopen(path.c_str(), "r+b");
+    if (!file) {
+        return rewrite(path, points, tangents, curves);
+    }
+    // The header goes last, once the records and the curve table are on the
+    // disk, so an interrupted save leaves a file that loads. Records changed
+    // in place may be old or new then. The table goes where the old header
+    // doesn't point.
+    size_t newCurvesSize = CurvesSize(curves);
+    size_t newCurvesOffset = FileSize(capacity);
+    if (newCurvesOffset + newCurvesSize > curvesOffset) {
+        newCurvesOffset = curvesOffset + curvesSize;
+    }
+    bool ok = true;
+    if (dirty) {
+        size_t end = std::min(dirtyLast + 1, points.size());
+        ok = WriteRange(file, capacity, points, tangents,
+                        std::min(dirtyFirst, end), end);
+    }
+    ok = ok && WriteRange(file, capacity, points, tangents,
+                          std::min(savedCount, points.size()), points.size());
+    ok = ok && WriteCurves(file, newCurvesOffset, curves) && Sync(file) &&
+         WriteHeader(file, points.size(), capacity, newCurvesOffset,
+                     tangents.method);
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return false;
+    }
+    savedCount = points.size();
+    curvesOffset = newCurvesOffset;
+    curvesSize = newCurvesSize;
+    dirty = false;
+    return true;
+}
+
+bool PointFileWriter::rewrite(const std::string& path,
+                              const std::vector<glm::dvec2>& points,
+                              const Tangents& tangents,
+                              const CurveTable& curves) {
+    // Write to a temporary file, so a failure keeps the old one intact
+    size_t newCapacity =
+        std::max(kMinCapacity, points.size() + points.size() / 2);
+    std::string temporaryPath = path + ".tmp";
+    FILE* file = fopen(temporaryPath.c_str(), "wb");
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", temporaryPath.c_str());
+        return false;
+    }
+    size_t newCurvesOffset = FileSize(newCapacity);
+    bool ok = WriteRange(file, newCapacity, points, tangents, 0,
+                         points.size()) &&
+              WriteHeader(file, points.size(), newCapacity, newCurvesOffset,
+                          tangents.method);
+    // The curve table after the slack extends the file, the slack reads as
+    // zeros
+    ok = ok && WriteCurves(file, newCurvesOffset, curves) && Sync(file);
+    ok = fclose(file) == 0 && ok;
+#ifdef _WIN32
+    // Windows does not rename over existing files
+    std::remove(path.c_str());
+#endif
+    if (!ok || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        fprintf(stderr, "Cannot write %s\n", path.c_str());
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    savedPath = path;
+    savedCount = points.size();
+    capacity = newCapacity;
+    curvesOffset = newCurvesOffset;
+    curvesSize = CurvesSize(curves);
+    dirty = false;
+    return true;
+}
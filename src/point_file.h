@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "curve_table.h"
+#include "tangents.h"
+
+// Binary point file, in native byte order:
+//
+//   PointFileHeader
+//   capacity PointFileRecords
+//   capacity pinned tangents, zero where the tangent is estimated
+//   at curvesOffset: the curve count as uint64_t, then one PointFileCurve
+//   per curve
+//
+// Only the first count records are valid. The slack lets a save append
+// points by writing the new records and the header. The curve table is
+// small and written whole on every save, to a place the old header doesn't
+// point to: right after the pinned tangents if it fits before the old
+// table, after the old table otherwise. An interrupted save so leaves the
+// old header with its table.
+//
+// Headers before version 4 end before curvesOffset, and their curve table
+// directly follows the pinned tangents. Files of versions 1 and 2 hold the
+// points as floats, in records of four floats with the tangent in the last
+// two, and files of version 1 have no curve table and hold one open curve.
+// They load, but a save writes the current version.
+struct PointFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t tangentMethod;
+    uint64_t count;
+    uint64_t capacity;
+    uint64_t curvesOffset;
+};
+
+struct PointFileRecord {
+    double point[2];
+    float tangent[2];
+};
+
+struct PointFileCurve {
+    uint64_t first, count;
+    uint32_t closed;
+    uint32_t reserved;
+    float color[4];
+};
+
+const uint32_t kPointFileVersion = 4;
+
+// Read-only memory mapping of a point file
+struct PointFileMapping {
+    const PointFileHeader* header = nullptr;
+    const glm::vec2* pinned = nullptr;
+    // Empty for files of version 1
+    const PointFileCurve* curves = nullptr;
+    size_t curveCount = 0;
+
+    // Map and validate the file, false with a message on stderr if that
+    // fails
+    bool open(const std::string& path);
+    void close();
+    glm::dvec2 point(size_t i) const;
+    glm::vec2 tangent(size_t i) const;
+
+   private:
+    // One of them, by the version
+    const PointFileRecord* records = nullptr;
+    const glm::vec4* floatRecords = nullptr;
+    void* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
+
+// Saves the points to a file, rewriting it only when it has to grow and
+// otherwise writing just the records that changed since the last save.
+struct PointFileWriter {
+    // Records of points first ... last need to be written on the next save
+    void markChanged(size_t first, size_t last);
+    // Continue incrementally with a file that has just been loaded, if it
+    // has the current version
+    void adopt(const std::string& path, const PointFileMapping& mapping);
+    bool save(const std::string& path, const std::vector<glm::dvec2>& points,
+              const Tangents& tangents, const CurveTable& curves);
+
+   private:
+    std::string savedPath;
+    size_t savedCount = 0;
+    size_t capacity = 0;
+    // Where the curve table of the saved header is, and its size in bytes
+    size_t curvesOffset = 0, curvesSize = 0;
+    bool dirty = false;
+    size_t dirtyFirst = 0, dirtyLast = 0;
+
+    bool rewrite(const std::string& path, const std::vector<glm::dvec2>& points,
+                 const Tangents& tangents, const CurveTable& curves);
+};
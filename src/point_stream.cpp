@@ -0,0 +1,208 @@
+#include "point_stream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Bytes per read call
+const size_t kReadSize = 1 << 16;
+// How often a blocked reader checks for a stop request
+const int kPollTimeoutMs = 100;
+
+#ifndef _WIN32
+// Wait until fd is readable, false on a stop request or error
+bool WaitReadable(int fd, const std::atomic<bool>& stop) {
+    while (!stop.load()) {
+        pollfd entry = {fd, POLLIN, 0};
+        int ready = poll(&entry, 1, kPollTimeoutMs);
+        if (ready > 0) {
+            return true;
+        }
+        if (ready < 0) {
+            return false;
+        }
+    }
+    return false;
+}
+#endif
+
+bool IsSeparator(char c) {
+    return c == ' ' || c == '\t' || c == ',' || c == '\r';
+}
+
+// Parse a number after optional separators, but not past the end of the
+// line, and advance c behind it
+bool ParseNumber(const char*& c, double& value) {
+    while (IsSeparator(*c)) {
+        ++c;
+    }
+    if (*c == '\n') {
+        return false;
+    }
+    char* next;
+    value = std::strtod(c, &next);
+    bool parsed = next != c;
+    c = next;
+    return parsed;
+}
+
+}  // namespace
+
+bool PointStream::open(const std::string& source) {
+    close();
+#ifdef _WIN32
+    fprintf(stderr, "Point streams are not supported on this platform\n");
+    return false;
+#else
+    if (source == "-") {
+        fd = STDIN_FILENO;
+    } else if (source.compare(0, 5, "unix:") == 0) {
+        socketPath = source.substr(5);
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            fprintf(stderr, "Socket path too long: %s\n", socketPath.c_str());
+            return false;
+        }
+        std::strcpy(address.sun_path, socketPath.c_str());
+        unlink(socketPath.c_str());
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd < 0 ||
+            bind(listenFd, reinterpret_cast<sockaddr*>(&address),
+                 sizeof(address)) != 0 ||
+            listen(listenFd, 1) != 0) {
+            fprintf(stderr, "Cannot listen on %s\n", socketPath.c_str());
+            close();
+            return false;
+        }
+    } else {
+        // Non-blocking, so opening a FIFO does not wait for a writer
+        fd = ::open(source.c_str(), O_RDONLY | O_NONBLOCK);
+        if (fd < 0) {
+            fprintf(stderr, "Cannot open %s\n", source.c_str());
+            return false;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    }
+    stopRequested = false;
+    endOfInput = false;
+    receivedCount = 0;
+    reader = std::thread(&PointStream::run, this);
+    return true;
+#endif
+}
+
+size_t PointStream::drain(std::vector<glm::dvec2>& points, size_t maxCount) {
+    size_t available = std::min(maxCount, queue.size());
+    if (available == 0) {
+        return 0;
+    }
+    size_t first = points.size();
+    points.resize(first + available);
+    size_t count = queue.pop(&points[first], available);
+    points.resize(first + count);
+    return count;
+}
+
+void PointStream::close() {
+    stopRequested = true;
+    if (reader.joinable()) {
+        reader.join();
+    }
+#ifndef _WIN32
+    if (fd >= 0 && fd != STDIN_FILENO) {
+        ::close(fd);
+    }
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        unlink(socketPath.c_str());
+    }
+#endif
+    fd = -1;
+    listenFd = -1;
+    // Drop what the main loop has not taken
+    glm::dvec2 discarded[256];
+    while (queue.pop(discarded, 256) > 0) {
+    }
+}
+
+void PointStream::run() {
+#ifndef _WIN32
+    if (listenFd < 0) {
+        readAll(fd);
+        endOfInput = true;
+        return;
+    }
+    while (WaitReadable(listenFd, stopRequested)) {
+        int connection = accept(listenFd, NULL, NULL);
+        if (connection >= 0) {
+            readAll(connection);
+            ::close(connection);
+        }
+    }
+#endif
+}
+
+void PointStream::readAll(int input) {
+#ifndef _WIN32
+    std::string buffer;
+    std::vector<glm::dvec2> batch;
+    char chunk[kReadSize];
+    while (WaitReadable(input, stopRequested)) {
+        ssize_t bytes = read(input, chunk, sizeof(chunk));
+        if (bytes <= 0) {
+            break;
+        }
+        buffer.append(chunk, static_cast<size_t>(bytes));
+        parse(buffer, batch);
+
+        // Wait for the main loop while the queue is full
+        size_t pushed = 0;
+        while (pushed < batch.size() && !stopRequested.load()) {
+            pushed += queue.push(batch.data() + pushed, batch.size() - pushed);
+            if (pushed < batch.size()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        receivedCount += batch.size();
+        batch.clear();
+    }
+#else
+    (void)input;
+#endif
+}
+
+void PointStream::parse(std::string& buffer, std::vector<glm::dvec2>& batch) {
+    size_t lineEnd = buffer.rfind('\n');
+    if (lineEnd == std::string::npos) {
+        return;
+    }
+    const char* c = buffer.c_str();
+    const char* end = c + lineEnd + 1;
+    while (c < end) {
+        double x, y;
+        bool valid = ParseNumber(c, x) && ParseNumber(c, y);
+        // Skip the rest of the line, which is all of it if it is malformed
+        while (*c != '\n') {
+            ++c;
+        }
+        ++c;
+        if (valid) {
+            batch.push_back(glm::dvec2(x, y));
+        }
+    }
+    buffer.erase(0, lineEnd + 1);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <glm/glm.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spsc_queue.h"
+
+// Reads points from another process on a background thread and hands them
+// to the main loop through a lock-free queue. The input is text with one
+// point per line, the coordinates separated by whitespace or a comma.
+// When the queue is full, the reader waits instead of dropping points.
+//
+// Sources are "-" for stdin, "unix:PATH" to listen on a Unix domain socket
+// and accept one writer after another, or the path of a file or FIFO, which
+// is read until its end. Only available on POSIX systems.
+struct PointStream {
+    PointStream() : queue(1 << 20) {}
+    ~PointStream() { close(); }
+
+    bool open(const std::string& source);
+    bool isOpen() const { return reader.joinable(); }
+    // Append up to maxCount of the queued points, returns how many
+    size_t drain(std::vector<glm::dvec2>& points, size_t maxCount);
+    void close();
+
+    // Points parsed by the reader so far
+    size_t received() const { return receivedCount.load(); }
+    // Whether the reader reached the end of a file or FIFO
+    bool ended() const { return endOfInput.load(); }
+
+   private:
+    SpscQueue<glm::dvec2> queue;
+    std::thread reader;
+    std::atomic<bool> stopRequested{false};
+    std::atomic<bool> endOfInput{false};
+    std::atomic<size_t> receivedCount{0};
+    int fd = -1;
+    int listenFd = -1;
+    std::string socketPath;
+
+    void run();
+    // Read from fd until its end or a stop request
+    void readAll(int input);
+    // Queue the points of the complete lines in the buffer and remove them
+    void parse(std::string& buffer, std::vector<glm::dvec2>& batch);
+};
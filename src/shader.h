@@ -0,0 +1,8 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Compile and link a program from a vertex shader and a fragment shader that
+// is concatenated from several sources. Errors are reported on stderr.
+GLuint CreateProgram(const char* vertexSource,
+                     const char* const* fragmentSources, int fragmentCount);
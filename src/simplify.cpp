@@ -0,0 +1,188 @@
+#include "simplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <glm/gtc/constants.hpp>
+
+#include "biarc_fit.h"
+#include "parallel.h"
+
+const char* const kSimplifyMethodNames[kSimplifyMethodCount] = {
+    "Ramer-Douglas-Peucker", "Curvature-aware", "Biarc fit"};
+
+namespace {
+
+// Fewest points a thread simplifies
+const size_t kChunkSize = 1 << 15;
+// Longest arc the curvature-aware variant replaces by its end points
+const double kMaxSweep = 0.5 * glm::pi<double>();
+
+double SegmentDistance(const glm::dvec2& x, const glm::dvec2& a,
+                       const glm::dvec2& b) {
+    glm::dvec2 ab = b - a;
+    double length2 = glm::dot(ab, ab);
+    double h = length2 > 0.0
+                   ? glm::clamp(glm::dot(x - a, ab) / length2, 0.0, 1.0)
+                   : 0.0;
+    return glm::length(x - a - ab * h);
+}
+
+double Cross(const glm::dvec2& a, const glm::dvec2& b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+// Unsigned angle between two vectors
+double Angle(const glm::dvec2& a, const glm::dvec2& b) {
+    return std::abs(std::atan2(Cross(a, b), glm::dot(a, b)));
+}
+
+// Point strictly between a and b farthest from their chord
+size_t FarthestFromChord(const std::vector<glm::dvec2>& points, size_t a,
+                         size_t b, double& distance) {
+    glm::dvec2 pa(points[a]), pb(points[b]);
+    size_t worst = a;
+    distance = 0.0;
+    for (size_t i = a + 1; i < b; ++i) {
+        double d = SegmentDistance(glm::dvec2(points[i]), pa, pb);
+        if (d > distance) {
+            distance = d;
+            worst = i;
+        }
+    }
+    return worst;
+}
+
+// Whether the points between a and b can be dropped, otherwise the point to
+// split at
+bool SpanFits(const std::vector<glm::dvec2>& points, size_t a, size_t b,
+              SimplifyMethod method, double tolerance, size_t& split) {
+    double distance;
+    split = FarthestFromChord(points, a, b, distance);
+    if (distance <= tolerance) {
+        return true;
+    }
+    if (method != kCurvatureAware) {
+        return false;
+    }
+
+    // Circle through both ends and the farthest point
+    glm::dvec2 p(points[a]), q(points[split]), r(points[b]);
+    double d = 2.0 * Cross(q - p, r - p);
+    if (std::abs(d) < 1.e-12) {
+        return false;
+    }
+    glm::dvec2 pq = q - p, pr = r - p;
+    glm::dvec2 c = p + glm::dvec2(pr.y * glm::dot(pq, pq) -
+                                      pq.y * glm::dot(pr, pr),
+                                  pq.x * glm::dot(pr, pr) -
+                                      pr.x * glm::dot(pq, pq)) /
+                           d;
+    double radius = glm::length(p - c);
+    if (Angle(p - c, q - c) + Angle(q - c, r - c) > kMaxSweep) {
+        return false;
+    }
+    double error = 0.0;
+    for (size_t i = a + 1; i < b; ++i) {
+        double e = std::abs(glm::length(glm::dvec2(points[i]) - c) - radius);
+        if (e > error) {
+            error = e;
+            split = i;
+        }
+    }
+    return error <= tolerance;
+}
+
+// Mark the points to keep strictly between first and last, keep[0] being
+// the flag of point offset
+void SimplifyChunk(const std::vector<glm::dvec2>& points, size_t first,
+                   size_t last, SimplifyMethod method, double tolerance,
+                   size_t offset, std::vector<char>& keep) {
+    // Explicit stack, the recursion can be as deep as the range is long
+    std::vector<std::pair<size_t, size_t> > spans;
+    spans.push_back(std::make_pair(first, last));
+    while (!spans.empty()) {
+        size_t a = spans.back().first;
+        size_t b = spans.back().second;
+        spans.pop_back();
+        size_t split;
+        if (b - a < 2 ||
+            SpanFits(points, a, b, method, tolerance, split)) {
+            continue;
+        }
+        keep[split - offset] = 1;
+        spans.push_back(std::make_pair(a, split));
+        spans.push_back(std::make_pair(split, b));
+    }
+}
+
+}  // namespace
+
+void Simplify(const std::vector<glm::dvec2>& points, size_t first, size_t last,
+              SimplifyMethod method, double tolerance,
+              std::vector<size_t>& kept) {
+    kept.clear();
+    if (last <= first + 1) {
+        for (size_t i = first; i <= last; ++i) {
+            kept.push_back(i);
+        }
+        return;
+    }
+
+    // Chunk boundaries are kept, so each chunk only marks its interior
+    size_t count = last - first + 1;
+    size_t chunks = ChunkCount(count - 1, kChunkSize);
+    std::vector<char> keep(count, 0);
+    for (size_t k = 0; k <= chunks; ++k) {
+        keep[(count - 1) * k / chunks] = 1;
+    }
+    ParallelChunks(count - 1, chunks, [&](size_t a, size_t b, size_t) {
+        SimplifyChunk(points, first + a, first + b, method, tolerance, first,
+                      keep);
+    });
+    for (size_t i = 0; i < count; ++i) {
+        if (keep[i]) {
+            kept.push_back(first + i);
+        }
+    }
+}
+
+void Simplifier::apply(std::vector<glm::dvec2>& points,
+                       std::vector<glm::vec2>& pinned, size_t first,
+                       TangentMethod tangentMethod) {
+    pointsIn = points.size() > first ? points.size() - first : 0;
+    pointsOut = pointsIn;
+    if (pointsIn < 3) {
+        return;
+    }
+    pinned.resize(points.size(), glm::vec2(0.0f));
+    if (method == kBiarcFit) {
+        std::vector<glm::dvec2> knots;
+        std::vector<glm::vec2> tangents;
+        std::vector<size_t> samples;
+        FitBiarcs(points, first, points.size() - 1, tolerance, tangentMethod,
+                  knots, tangents, &samples);
+        // Knots go to the front in order, so sample k is read before it is
+        // overwritten
+        for (size_t k = 0; k < knots.size(); ++k) {
+            glm::vec2 userPin = pinned[samples[k]];
+            points[first + k] = knots[k];
+            pinned[first + k] = userPin != glm::vec2(0.0f) ? userPin
+                                                           : tangents[k];
+        }
+        points.resize(first + knots.size());
+        pinned.resize(points.size());
+        pointsOut = knots.size();
+        return;
+    }
+    std::vector<size_t> kept;
+    Simplify(points, first, points.size() - 1, method, tolerance, kept);
+    for (size_t k = 0; k < kept.size(); ++k) {
+        points[first + k] = points[kept[k]];
+        pinned[first + k] = pinned[kept[k]];
+    }
+    points.resize(first + kept.size());
+    pinned.resize(points.size());
+    pointsOut = kept.size();
+}
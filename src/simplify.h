@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "tangents.h"
+
+enum SimplifyMethod {
+    // Ramer-Douglas-Peucker, which measures the deviation from the chords
+    kRamerDouglasPeucker,
+    // Like Ramer-Douglas-Peucker, but measures the deviation from the
+    // circular arc through the ends of a span and its farthest point, so
+    // evenly curved stretches, which the biarcs follow anyway, keep fewer
+    // points
+    kCurvatureAware,
+    // Replaces the points by the fewest biarcs within the tolerance, see
+    // `FitBiarcs`. The knots keep their fitted tangents pinned.
+    kBiarcFit,
+    kSimplifyMethodCount
+};
+
+extern const char* const kSimplifyMethodNames[kSimplifyMethodCount];
+
+// Indices of the points first ... last to keep so that the dropped ones stay
+// within tolerance pixels of the simplified polyline, or of its arcs. Both
+// ends are kept. Large ranges are split into chunks that are simplified on
+// separate threads, and the chunk boundaries are kept, too.
+void Simplify(const std::vector<glm::dvec2>& points, size_t first, size_t last,
+              SimplifyMethod method, double tolerance,
+              std::vector<size_t>& kept);
+
+// Simplification settings and the report of the last run
+struct Simplifier {
+    SimplifyMethod method = kRamerDouglasPeucker;
+    float tolerance = 0.5f;
+    // Whether to simplify freehand strokes and streamed points as they come
+    bool onInput = false;
+
+    size_t pointsIn = 0, pointsOut = 0;
+
+    // Simplify the points from first to the end in place and drop the
+    // pinned tangents of the removed points alongside. kBiarcFit estimates
+    // the tangents of the samples with tangentMethod and pins the fitted
+    // ones on the knots that had no pinned tangent yet.
+    void apply(std::vector<glm::dvec2>& points,
+               std::vector<glm::vec2>& pinned, size_t first,
+               TangentMethod tangentMethod);
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+// Items are moved in batches, each of which costs one acquire and one
+// release on the shared indices. The indices only ever grow and are masked
+// into the power-of-two ring.
+template <typename T>
+struct SpscQueue {
+    explicit SpscQueue(size_t minCapacity) {
+        size_t capacity = 1;
+        while (capacity < minCapacity) {
+            capacity *= 2;
+        }
+        slots.resize(capacity);
+        mask = capacity - 1;
+    }
+
+    // Producer: append up to count items, returns how many fit
+    size_t push(const T* items, size_t count) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_acquire);
+        size_t n = std::min(count, slots.size() - (t - h));
+        for (size_t i = 0; i < n; ++i) {
+            slots[(t + i) & mask] = items[i];
+        }
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer: remove up to count items into out, returns how many
+    size_t pop(T* out, size_t count) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t t = tail.load(std::memory_order_acquire);
+        size_t n = std::min(count, t - h);
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = slots[(h + i) & mask];
+        }
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    // Either side: snapshot of the number of queued items
+    size_t size() const {
+        // Head first, it can not pass a later tail
+        size_t h = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - h;
+    }
+
+   private:
+    std::vector<T> slots;
+    size_t mask;
+    // On separate cache lines, so the two threads do not share one
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+};
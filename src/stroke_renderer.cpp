@@ -0,0 +1,296 @@
+#include "stroke_renderer.h"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+#include "biarc.h"
+#include "point_buffer.h"
+#include "shader.h"
+
+namespace {
+
+// Both vertex shaders start with the version, kViewSource goes after it
+const char* versionSource = R"(
+    #version 330 core
+)";
+
+// Strip vertices are offsets in world units from the float origin of their
+// segment, which keeps them exact far from the world origin
+const char* strokeVertexSource = R"(
+    layout (location = 0) in vec2 aOrigin;
+    layout (location = 1) in vec2 aOffset;
+    layout (location = 2) in float aAcross;
+
+    uniform vec2 windowSize;
+
+    out float across;
+
+    void main() {
+        across = aAcross;
+        // Window pixels have their origin in the upper left corner
+        vec2 view = to_view(aOrigin) + aOffset * viewScale;
+        vec2 ndc = 2.0 * view / windowSize - 1.0;
+        gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+    }
+)";
+
+const char* strokeFragmentSource = R"(
+    #version 330 core
+    uniform float halfWidth;
+
+    in float across;
+    out vec4 fragColor;
+
+    void main() {
+        float coverage = clamp(halfWidth + 0.5 - abs(across), 0.0, 1.0);
+        fragColor = vec4(1.0, 1.0, 1.0, coverage);
+    }
+)";
+
+// Control points as point sprites, fetched straight from the points TBO.
+// kViewSource and kPointFetchSource go before.
+const char* pointVertexSource = R"(
+    uniform vec2 windowSize;
+    uniform int nearestIndex;
+
+    flat out int isNearest;
+
+    void main() {
+        vec2 point = fetch_point(gl_VertexID).xy;
+        isNearest = int(gl_VertexID == nearestIndex);
+        gl_PointSize = isNearest != 0 ? 16.0 : 10.0;
+        vec2 ndc = 2.0 * point / windowSize - 1.0;
+        gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+    }
+)";
+
+const char* pointFragmentSource = R"(
+    #version 330 core
+    flat in int isNearest;
+    out vec4 fragColor;
+
+    void main() {
+        if (length(gl_PointCoord - 0.5) > 0.5) {
+            discard;
+        }
+        fragColor = vec4(
+            isNearest != 0 ? vec3(1.0, 0.5, 0.5) : vec3(1.0, 0.0, 0.0), 1.0);
+    }
+)";
+
+// Upper bound on the subdivision of a single arc
+const int kMaxChords = 64;
+
+// Segment origin, offset and distance across
+const GLsizei kVertexFloats = 5;
+
+}  // namespace
+
+void StrokeRenderer::init() {
+    std::string strokeSource =
+        std::string(versionSource) + kViewSource + strokeVertexSource;
+    strokeProgram =
+        CreateProgram(strokeSource.c_str(), &strokeFragmentSource, 1);
+    std::string pointSource = std::string(versionSource) + kViewSource +
+                              kPointFetchSource + pointVertexSource;
+    pointProgram =
+        CreateProgram(pointSource.c_str(), &pointFragmentSource, 1);
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLsizei stride = kVertexFloats * sizeof(float);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride,
+                          (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride,
+                          (void*)(4 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    // Core profile needs a bound VAO even without attributes
+    glGenVertexArrays(1, &emptyVAO);
+
+    dirtyBegin = std::numeric_limits<GLsizei>::max();
+}
+
+void StrokeRenderer::tessellate(const std::vector<glm::dvec2>& points,
+                                const std::vector<glm::vec2>& tangents,
+                                const CurveTable& curves, size_t i,
+                                std::vector<float>& strip) const {
+    strip.clear();
+    if (!curves.joins(i)) {
+        return;
+    }
+    Biarc biarc = curves.segmentBiarc(points, tangents, i);
+    // One pixel beyond the stroke for anti-aliasing, the strip carries the
+    // distance across in pixels
+    float w = halfWidth + 1.0f;
+    double offset = w / viewScale;
+    // The offsets are taken in doubles from the rounded origin
+    glm::vec2 origin(biarc.a.pointAt(0.0));
+    glm::dvec2 center(origin);
+    auto emit = [&](const glm::dvec2& p, const glm::dvec2& t) {
+        glm::dvec2 n(-t.y, t.x);
+        glm::dvec2 left = p + n * offset - center;
+        glm::dvec2 right = p - n * offset - center;
+        const float pair[] = {origin.x,
+                              origin.y,
+                              static_cast<float>(left.x),
+                              static_cast<float>(left.y),
+                              w,
+                              origin.x,
+                              origin.y,
+                              static_cast<float>(right.x),
+                              static_cast<float>(right.y),
+                              -w};
+        strip.insert(strip.end(), pair, pair + 2 * kVertexFloats);
+    };
+    double worldTolerance = tolerance / viewScale;
+    int na = biarc.a.chordCount(worldTolerance, kMaxChords);
+    for (int k = 0; k <= na; ++k) {
+        double u = double(k) / na;
+        emit(biarc.a.pointAt(u), biarc.a.tangentAt(u));
+    }
+    // The second arc runs backwards, from the end point to the joint
+    int nb = biarc.b.chordCount(worldTolerance, kMaxChords);
+    for (int k = nb - 1; k >= 0; --k) {
+        double u = double(k) / nb;
+        emit(biarc.b.pointAt(u), -biarc.b.tangentAt(u));
+    }
+}
+
+void StrokeRenderer::writeSegment(size_t i, const std::vector<float>& strip) {
+    GLsizei count = static_cast<GLsizei>(strip.size() / kVertexFloats);
+    if (count > capacities[i]) {
+        // Move to the end with some slack for future edits
+        unusedVertices += capacities[i];
+        capacities[i] = count + count / 4 + 2;
+        firsts[i] = usedVertices;
+        usedVertices += capacities[i];
+        vertices.resize(static_cast<size_t>(usedVertices) * kVertexFloats);
+        reallocate = reallocate || usedVertices > gpuCapacity;
+    }
+    std::copy(strip.begin(), strip.end(),
+              vertices.begin() + firsts[i] * kVertexFloats);
+    counts[i] = count;
+    dirtyBegin = std::min(dirtyBegin, firsts[i]);
+    dirtyEnd = std::max(dirtyEnd, firsts[i] + count);
+}
+
+void StrokeRenderer::upload() {
+    const size_t vertexSize = kVertexFloats * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    if (reallocate) {
+        gpuCapacity = usedVertices + usedVertices / 2;
+        glBufferData(GL_ARRAY_BUFFER, gpuCapacity * vertexSize, NULL,
+                     GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, usedVertices * vertexSize,
+                        vertices.data());
+        reallocate = false;
+    } else if (dirtyBegin < dirtyEnd) {
+        glBufferSubData(GL_ARRAY_BUFFER, dirtyBegin * vertexSize,
+                        (dirtyEnd - dirtyBegin) * vertexSize,
+                        vertices.data() + dirtyBegin * kVertexFloats);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    dirtyBegin = std::numeric_limits<GLsizei>::max();
+    dirtyEnd = 0;
+}
+
+void StrokeRenderer::rebuild(const std::vector<glm::dvec2>& points,
+                             const std::vector<glm::vec2>& tangents,
+                             const CurveTable& curves) {
+    size_t segments = curves.segmentCount(points.size());
+    firsts.assign(segments, 0);
+    counts.assign(segments, 0);
+    capacities.assign(segments, 0);
+    vertices.clear();
+    usedVertices = 0;
+    unusedVertices = 0;
+    std::vector<float> strip;
+    for (size_t i = 0; i < segments; ++i) {
+        tessellate(points, tangents, curves, i, strip);
+        writeSegment(i, strip);
+    }
+    reallocate = true;
+    upload();
+}
+
+void StrokeRenderer::update(const std::vector<glm::dvec2>& points,
+                            const std::vector<glm::vec2>& tangents,
+                            const CurveTable& curves, size_t first,
+                            size_t last) {
+    size_t segments = curves.segmentCount(points.size());
+    if (segments < firsts.size()) {
+        rebuild(points, tangents, curves);
+        return;
+    }
+    // New segments get an empty range, which makes them allocate one
+    firsts.resize(segments, 0);
+    counts.resize(segments, 0);
+    capacities.resize(segments, 0);
+    if (segments == 0) {
+        return;
+    }
+
+    // Tangents depend on the neighbors, so the segments from two before
+    // up to one after the changed points are affected
+    size_t begin = first >= 2 ? first - 2 : 0;
+    size_t end = std::min(last + 1, segments - 1);
+    std::vector<float> strip;
+    for (size_t i = begin; i <= end; ++i) {
+        tessellate(points, tangents, curves, i, strip);
+        writeSegment(i, strip);
+    }
+
+    if (unusedVertices > usedVertices / 2) {
+        rebuild(points, tangents, curves);
+        return;
+    }
+    upload();
+}
+
+void StrokeRenderer::draw(const PointBuffer& pointBuffer, const Camera& camera,
+                          int width, int height, int pointCount,
+                          int nearestIndex) {
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glUseProgram(strokeProgram);
+    glUniform2f(glGetUniformLocation(strokeProgram, "windowSize"),
+                static_cast<GLfloat>(width), static_cast<GLfloat>(height));
+    glUniform1f(glGetUniformLocation(strokeProgram, "halfWidth"), halfWidth);
+    camera.bind(strokeProgram);
+    glBindVertexArray(VAO);
+    glMultiDrawArrays(GL_TRIANGLE_STRIP, firsts.data(), counts.data(),
+                      static_cast<GLsizei>(firsts.size()));
+
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glUseProgram(pointProgram);
+    pointBuffer.bind(pointProgram);
+    camera.bind(pointProgram);
+    glUniform2f(glGetUniformLocation(pointProgram, "windowSize"),
+                static_cast<GLfloat>(width), static_cast<GLfloat>(height));
+    glUniform1i(glGetUniformLocation(pointProgram, "nearestIndex"),
+                nearestIndex);
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_POINTS, 0, pointCount);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+
+    glBindVertexArray(0);
+    glDisable(GL_BLEND);
+}
+
+void StrokeRenderer::cleanup() {
+    glDeleteProgram(strokeProgram);
+    glDeleteProgram(pointProgram);
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteVertexArrays(1, &emptyVAO);
+    glDeleteBuffers(1, &VBO);
+}
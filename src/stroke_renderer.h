@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "camera.h"
+#include "curve_table.h"
+#include "point_buffer.h"
+
+// Renders the curve as a stroke without any distance field: every biarc is
+// tessellated into a triangle strip whose vertices carry the distance across
+// the strip, which gives a 1D SDF for anti-aliasing.
+//
+// Each segment owns a range of the vertex buffer with some slack, so an edit
+// only retessellates and re-uploads the segments it affects. Segments that
+// outgrow their range are moved to the end, and the buffer is compacted once
+// too much of it is unused. The segments between two curves stay empty.
+struct StrokeRenderer {
+    float halfWidth = 2.0f;
+    // Maximum deviation of the strip center from the arcs in pixels
+    float tolerance = 0.1f;
+    // Window pixels per world unit the strips are tessellated for, the
+    // strips need a rebuild when it changes
+    double viewScale = 1.0;
+
+    void init();
+    // Retessellate all segments
+    void rebuild(const std::vector<glm::dvec2>& points,
+                 const std::vector<glm::vec2>& tangents,
+                 const CurveTable& curves);
+    // Retessellate the segments affected by a change of the points
+    // first ... last, including points appended at the end
+    void update(const std::vector<glm::dvec2>& points,
+                const std::vector<glm::vec2>& tangents,
+                const CurveTable& curves, size_t first, size_t last);
+    // Draw the strips and the control points, which are read from the
+    // point buffer, through the camera
+    void draw(const PointBuffer& pointBuffer, const Camera& camera, int width,
+              int height, int pointCount, int nearestIndex);
+    void cleanup();
+
+   private:
+    GLuint strokeProgram, pointProgram;
+    GLuint VAO, VBO, emptyVAO;
+
+    // Vertex range of each segment, 5 floats per vertex
+    std::vector<GLint> firsts;
+    std::vector<GLsizei> counts, capacities;
+    std::vector<float> vertices;
+    GLsizei usedVertices = 0, unusedVertices = 0;
+    GLsizei gpuCapacity = 0;
+    // Vertices to upload
+    GLsizei dirtyBegin = 0, dirtyEnd = 0;
+    bool reallocate = false;
+
+    void tessellate(const std::vector<glm::dvec2>& points,
+                    const std::vector<glm::vec2>& tangents,
+                    const CurveTable& curves, size_t i,
+                    std::vector<float>& strip) const;
+    void writeSegment(size_t i, const std::vector<float>& strip);
+    void upload();
+};
@@ -0,0 +1,653 @@
+#include "svg_import.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <glm/gtc/constants.hpp>
+
+#include "biarc.h"
+
+namespace {
+
+// Points at which a biarc is compared to its cubic
+const int kErrorSamples = 16;
+// Deepest subdivision of a cubic, beyond which the biarc is taken as is
+const int kMaxDepth = 24;
+// Biarcs much longer than their cubic loop where the cubic does not go
+const double kMaxLengthRatio = 1.1;
+// Turns sharper than this (about 0.1 degrees) are corners
+const double kCornerCos = 0.999998;
+// Distance between the two knots of a corner
+const double kCornerGap = 0.01;
+// Bytes per read call
+const size_t kReadSize = 1 << 16;
+// Path data waiting for a worker, per worker
+const size_t kQueuedPathsPerWorker = 2;
+
+struct Cubic {
+    glm::dvec2 p[4];
+};
+
+glm::dvec2 CubicPoint(const Cubic& c, double t) {
+    double s = 1.0 - t;
+    return s * s * s * c.p[0] + 3.0 * s * s * t * c.p[1] +
+           3.0 * s * t * t * c.p[2] + t * t * t * c.p[3];
+}
+
+// Split at t = 1/2 with de Casteljau's algorithm
+void SplitCubic(const Cubic& c, Cubic& left, Cubic& right) {
+    glm::dvec2 p01 = 0.5 * (c.p[0] + c.p[1]);
+    glm::dvec2 p12 = 0.5 * (c.p[1] + c.p[2]);
+    glm::dvec2 p23 = 0.5 * (c.p[2] + c.p[3]);
+    glm::dvec2 p012 = 0.5 * (p01 + p12);
+    glm::dvec2 p123 = 0.5 * (p12 + p23);
+    glm::dvec2 mid = 0.5 * (p012 + p123);
+    left.p[0] = c.p[0];
+    left.p[1] = p01;
+    left.p[2] = p012;
+    left.p[3] = mid;
+    right.p[0] = mid;
+    right.p[1] = p123;
+    right.p[2] = p23;
+    right.p[3] = c.p[3];
+}
+
+// Unit tangent at the start, from the first control point that differs
+// from it. False if all four points coincide.
+bool StartTangent(const Cubic& c, glm::dvec2& t) {
+    for (int k = 1; k < 4; ++k) {
+        glm::dvec2 d = c.p[k] - c.p[0];
+        if (glm::dot(d, d) > 1.e-18) {
+            t = glm::normalize(d);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool EndTangent(const Cubic& c, glm::dvec2& t) {
+    for (int k = 2; k >= 0; --k) {
+        glm::dvec2 d = c.p[3] - c.p[k];
+        if (glm::dot(d, d) > 1.e-18) {
+            t = glm::normalize(d);
+            return true;
+        }
+    }
+    return false;
+}
+
+double SegmentDistance(const glm::dvec2& x, const glm::dvec2& a,
+                       const glm::dvec2& b) {
+    glm::dvec2 ab = b - a;
+    double length2 = glm::dot(ab, ab);
+    double h = length2 > 0.0
+                   ? glm::clamp(glm::dot(x - a, ab) / length2, 0.0, 1.0)
+                   : 0.0;
+    return glm::length(x - a - ab * h);
+}
+
+// Whether the biarc stays within tolerance of the cubic, judged by the
+// distance of samples of the cubic from the biarc and of the joint from
+// the cubic
+bool BiarcFits(const Cubic& c, const Biarc& biarc, double tolerance) {
+    glm::dvec2 samples[kErrorSamples + 1];
+    double length = 0.0;
+    samples[0] = c.p[0];
+    for (int i = 1; i <= kErrorSamples; ++i) {
+        samples[i] = CubicPoint(c, static_cast<double>(i) / kErrorSamples);
+        length += glm::distance(samples[i - 1], samples[i]);
+        if (i < kErrorSamples && biarc.distance(samples[i]) > tolerance) {
+            return false;
+        }
+    }
+    if (biarc.length() > kMaxLengthRatio * length + tolerance) {
+        return false;
+    }
+    double joint = HUGE_VAL;
+    for (int i = 0; i < kErrorSamples; ++i) {
+        joint = std::min(joint,
+                         SegmentDistance(biarc.a.q, samples[i], samples[i + 1]));
+    }
+    return joint <= tolerance;
+}
+
+// The closing segment returns to the first knot, so the knot that repeats
+// it at the end goes away. At a corner it stays as the knot before the
+// corner, and the first knot moves to after it.
+void CloseCurve(BiarcCurve& curve) {
+    curve.closed = true;
+    if (curve.points.size() < 3 ||
+        curve.points.back() != curve.points.front()) {
+        return;
+    }
+    glm::dvec2 first(curve.tangents.front());
+    if (glm::dot(glm::dvec2(curve.tangents.back()), first) < kCornerCos) {
+        curve.points.front() += kCornerGap * first;
+    } else {
+        curve.points.pop_back();
+        curve.tangents.pop_back();
+    }
+}
+
+// Builds the curves of one path from its drawing commands
+struct PathBuilder {
+    double tolerance;
+    std::vector<BiarcCurve>& curves;
+    glm::dvec2 start, current;
+    // Whether curves.back() is the curve of the current subpath
+    bool drawing;
+
+    PathBuilder(double tolerance, std::vector<BiarcCurve>& curves)
+        : tolerance(tolerance),
+          curves(curves),
+          start(0.0),
+          current(0.0),
+          drawing(false) {}
+
+    void moveTo(const glm::dvec2& p) {
+        drawing = false;
+        start = current = p;
+    }
+
+    void lineTo(const glm::dvec2& p) {
+        cubicTo(current + (p - current) / 3.0, p + (current - p) / 3.0, p);
+    }
+
+    void quadTo(const glm::dvec2& c, const glm::dvec2& p) {
+        cubicTo(current + 2.0 / 3.0 * (c - current),
+                p + 2.0 / 3.0 * (c - p), p);
+    }
+
+    void cubicTo(const glm::dvec2& c1, const glm::dvec2& c2,
+                 const glm::dvec2& p) {
+        Cubic cubic = {{current, c1, c2, p}};
+        current = p;
+        glm::dvec2 t;
+        if (!StartTangent(cubic, t)) {
+            return;
+        }
+        if (!drawing) {
+            curves.push_back(BiarcCurve());
+            curves.back().points.push_back(cubic.p[0]);
+            curves.back().tangents.push_back(glm::vec2(t));
+            drawing = true;
+        } else if (glm::dot(glm::dvec2(curves.back().tangents.back()), t) <
+                   kCornerCos) {
+            curves.back().points.push_back(cubic.p[0] + kCornerGap * t);
+            curves.back().tangents.push_back(glm::vec2(t));
+        }
+        CubicToBiarcs(cubic.p, tolerance, curves.back());
+    }
+
+    // Elliptical arc, converted to the center parameterization as in the
+    // implementation notes of the SVG specification, then approximated by
+    // one cubic per quarter turn
+    void arcTo(double rx, double ry, double rotation, bool largeArc,
+               bool sweep, const glm::dvec2& p) {
+        rx = std::abs(rx);
+        ry = std::abs(ry);
+        if (p == current) {
+            return;
+        }
+        if (rx == 0.0 || ry == 0.0) {
+            lineTo(p);
+            return;
+        }
+        double phi = glm::radians(rotation);
+        double cosPhi = std::cos(phi), sinPhi = std::sin(phi);
+        glm::dvec2 d = 0.5 * (current - p);
+        glm::dvec2 x1(cosPhi * d.x + sinPhi * d.y,
+                      -sinPhi * d.x + cosPhi * d.y);
+        double lambda = x1.x * x1.x / (rx * rx) + x1.y * x1.y / (ry * ry);
+        if (lambda > 1.0) {
+            rx *= std::sqrt(lambda);
+            ry *= std::sqrt(lambda);
+        }
+        double rx2 = rx * rx, ry2 = ry * ry;
+        double den = rx2 * x1.y * x1.y + ry2 * x1.x * x1.x;
+        double coef = std::sqrt(std::max(0.0, (rx2 * ry2 - den) / den));
+        if (largeArc == sweep) {
+            coef = -coef;
+        }
+        glm::dvec2 c1(coef * rx * x1.y / ry, -coef * ry * x1.x / rx);
+        glm::dvec2 center =
+            glm::dvec2(cosPhi * c1.x - sinPhi * c1.y,
+                       sinPhi * c1.x + cosPhi * c1.y) +
+            0.5 * (current + p);
+        glm::dvec2 u((x1.x - c1.x) / rx, (x1.y - c1.y) / ry);
+        glm::dvec2 v((-x1.x - c1.x) / rx, (-x1.y - c1.y) / ry);
+        double theta = std::atan2(u.y, u.x);
+        double delta =
+            std::atan2(u.x * v.y - u.y * v.x, glm::dot(u, v));
+        if (!sweep && delta > 0.0) {
+            delta -= glm::two_pi<double>();
+        } else if (sweep && delta < 0.0) {
+            delta += glm::two_pi<double>();
+        }
+
+        int n = std::max(
+            1, static_cast<int>(std::ceil(std::abs(delta) /
+                                          glm::half_pi<double>() - 1.e-9)));
+        double step = delta / n;
+        double k = 4.0 / 3.0 * std::tan(0.25 * step);
+        glm::dvec2 end = p;
+        for (int i = 0; i < n; ++i) {
+            double a0 = theta + i * step, a1 = a0 + step;
+            glm::dvec2 d0(-rx * std::sin(a0), ry * std::cos(a0));
+            glm::dvec2 d1(-rx * std::sin(a1), ry * std::cos(a1));
+            glm::dvec2 e1(rx * std::cos(a1), ry * std::sin(a1));
+            glm::dvec2 r0(cosPhi * d0.x - sinPhi * d0.y,
+                          sinPhi * d0.x + cosPhi * d0.y);
+            glm::dvec2 r1(cosPhi * d1.x - sinPhi * d1.y,
+                          sinPhi * d1.x + cosPhi * d1.y);
+            glm::dvec2 q = i + 1 == n
+                               ? end
+                               : center + glm::dvec2(
+                                              cosPhi * e1.x - sinPhi * e1.y,
+                                              sinPhi * e1.x + cosPhi * e1.y);
+            cubicTo(current + k * r0, q - k * r1, q);
+        }
+    }
+
+    void closePath() {
+        if (drawing && current != start) {
+            lineTo(start);
+        }
+        if (drawing) {
+            CloseCurve(curves.back());
+        }
+        moveTo(start);
+    }
+};
+
+// Tokenizer of path data, which is null-terminated
+struct PathDataReader {
+    const char* c;
+
+    void skipSeparators() {
+        while (std::isspace(static_cast<unsigned char>(*c)) || *c == ',') {
+            ++c;
+        }
+    }
+
+    // Whether a number follows, which continues the previous command
+    bool hasNumber() {
+        skipSeparators();
+        return *c == '-' || *c == '+' || *c == '.' ||
+               std::isdigit(static_cast<unsigned char>(*c));
+    }
+
+    bool number(double& value) {
+        skipSeparators();
+        char* next;
+        value = std::strtod(c, &next);
+        bool parsed = next != c;
+        c = next;
+        return parsed;
+    }
+
+    bool point(glm::dvec2& p) { return number(p.x) && number(p.y); }
+
+    // Arc flags may be written without separators, as in "a1 1 0 011 1"
+    bool flag(bool& value) {
+        skipSeparators();
+        if (*c != '0' && *c != '1') {
+            return false;
+        }
+        value = *c++ == '1';
+        return true;
+    }
+};
+
+// Find the value of the attribute name in the text of a tag
+bool FindAttribute(const std::string& tag, const char* name,
+                   std::string& value) {
+    size_t length = std::strlen(name);
+    for (size_t i = tag.find(name); i != std::string::npos;
+         i = tag.find(name, i + 1)) {
+        if (i > 0 && !std::isspace(static_cast<unsigned char>(tag[i - 1]))) {
+            continue;
+        }
+        size_t j = i + length;
+        while (j < tag.size() &&
+               std::isspace(static_cast<unsigned char>(tag[j]))) {
+            ++j;
+        }
+        if (j >= tag.size() || tag[j] != '=') {
+            continue;
+        }
+        ++j;
+        while (j < tag.size() &&
+               std::isspace(static_cast<unsigned char>(tag[j]))) {
+            ++j;
+        }
+        if (j >= tag.size() || (tag[j] != '"' && tag[j] != '\'')) {
+            continue;
+        }
+        size_t end = tag.find(tag[j], j + 1);
+        if (end == std::string::npos) {
+            return false;
+        }
+        value.assign(tag, j + 1, end - j - 1);
+        return true;
+    }
+    return false;
+}
+
+// Finds the path data of the <path> elements in a file read in chunks.
+// Only the text of the current tag is kept, and only for paths.
+struct SvgScanner {
+    enum State { kText, kName, kTag, kPathTag, kComment };
+    State state = kText;
+    std::string name;
+    std::string tag;
+    char quote = 0;
+
+    // Feed the next chunk, calling found(data) for each path
+    template <typename Found>
+    void scan(const char* data, size_t size, Found found) {
+        for (size_t i = 0; i < size;) {
+            char c = data[i];
+            switch (state) {
+                case kText:
+                    if (c == '<') {
+                        state = kName;
+                        name.clear();
+                    }
+                    ++i;
+                    break;
+                case kName:
+                    if (std::isspace(static_cast<unsigned char>(c)) ||
+                        c == '>' || c == '/') {
+                        // Look at the end of the name again in the tag
+                        state = name == "path" ? kPathTag : kTag;
+                        tag.clear();
+                        quote = 0;
+                        break;
+                    }
+                    name += c;
+                    if (name == "!--") {
+                        state = kComment;
+                        name.clear();
+                    }
+                    ++i;
+                    break;
+                case kTag:
+                case kPathTag:
+                    if (quote) {
+                        quote = c == quote ? 0 : quote;
+                    } else if (c == '"' || c == '\'') {
+                        quote = c;
+                    } else if (c == '>') {
+                        std::string d;
+                        if (state == kPathTag && FindAttribute(tag, "d", d)) {
+                            found(d);
+                        }
+                        state = kText;
+                        tag.clear();
+                        ++i;
+                        break;
+                    }
+                    if (state == kPathTag) {
+                        tag += c;
+                    }
+                    ++i;
+                    break;
+                case kComment:
+                    // name holds the last two characters
+                    if (c == '>' && name == "--") {
+                        state = kText;
+                    }
+                    name += c;
+                    if (name.size() > 2) {
+                        name.erase(0, name.size() - 2);
+                    }
+                    ++i;
+                    break;
+            }
+        }
+    }
+};
+
+// Path data handed from the scanner to the workers, and the curves they
+// return, indexed by the position of the path in the file
+struct ImportQueue {
+    std::mutex mutex;
+    std::condition_variable notEmpty, notFull;
+    std::deque<std::pair<size_t, std::string> > paths;
+    std::vector<std::vector<BiarcCurve> > results;
+    size_t capacity;
+    bool done = false;
+
+    void push(std::string& data) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return paths.size() < capacity; });
+        paths.push_back(std::make_pair(results.size(), std::string()));
+        paths.back().second.swap(data);
+        results.push_back(std::vector<BiarcCurve>());
+        notEmpty.notify_one();
+    }
+
+    void finish() {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        notEmpty.notify_all();
+    }
+
+    void work(double tolerance) {
+        for (;;) {
+            std::pair<size_t, std::string> path;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                notEmpty.wait(lock, [this] { return done || !paths.empty(); });
+                if (paths.empty()) {
+                    return;
+                }
+                path.first = paths.front().first;
+                path.second.swap(paths.front().second);
+                paths.pop_front();
+                notFull.notify_one();
+            }
+            std::vector<BiarcCurve> curves;
+            ParsePathData(path.second, tolerance, curves);
+            std::lock_guard<std::mutex> lock(mutex);
+            results[path.first].swap(curves);
+        }
+    }
+};
+
+}  // namespace
+
+void CubicToBiarcs(const glm::dvec2 c[4], double tolerance,
+                   BiarcCurve& curve) {
+    // Pieces still to fit, the next one on top
+    std::vector<std::pair<Cubic, int> > pieces;
+    Cubic whole = {{c[0], c[1], c[2], c[3]}};
+    pieces.push_back(std::make_pair(whole, 0));
+    while (!pieces.empty()) {
+        Cubic piece = pieces.back().first;
+        int depth = pieces.back().second;
+        pieces.pop_back();
+        glm::dvec2 t0, t1;
+        if (!StartTangent(piece, t0) || !EndTangent(piece, t1)) {
+            continue;
+        }
+        Biarc biarc = MakeBiarc(piece.p[0], t0, piece.p[3], t1);
+        if (depth < kMaxDepth && !BiarcFits(piece, biarc, tolerance)) {
+            Cubic left, right;
+            SplitCubic(piece, left, right);
+            pieces.push_back(std::make_pair(right, depth + 1));
+            pieces.push_back(std::make_pair(left, depth + 1));
+            continue;
+        }
+        curve.points.push_back(piece.p[3]);
+        curve.tangents.push_back(glm::vec2(t1));
+    }
+}
+
+void ParsePathData(const std::string& data, double tolerance,
+                   std::vector<BiarcCurve>& curves) {
+    PathBuilder builder(tolerance, curves);
+    PathDataReader reader = {data.c_str()};
+    // Second control point of the last curve, for the smooth variants
+    glm::dvec2 control(0.0);
+    char previous = 0;
+    for (;;) {
+        reader.skipSeparators();
+        char command = *reader.c;
+        if (!std::isalpha(static_cast<unsigned char>(command))) {
+            return;
+        }
+        ++reader.c;
+        bool relative = std::islower(static_cast<unsigned char>(command));
+        char upper = static_cast<char>(
+            std::toupper(static_cast<unsigned char>(command)));
+        if (upper == 'Z') {
+            builder.closePath();
+            previous = upper;
+            continue;
+        }
+        // Commands repeat while numbers follow, but at least once
+        bool first = true;
+        while (first || reader.hasNumber()) {
+            glm::dvec2 origin = relative ? builder.current : glm::dvec2(0.0);
+            glm::dvec2 p, c1, c2;
+            double value;
+            switch (upper) {
+                case 'M':
+                    if (!reader.point(p)) {
+                        return;
+                    }
+                    if (first) {
+                        builder.moveTo(origin + p);
+                    } else {
+                        builder.lineTo(origin + p);
+                    }
+                    break;
+                case 'L':
+                    if (!reader.point(p)) {
+                        return;
+                    }
+                    builder.lineTo(origin + p);
+                    break;
+                case 'H':
+                    if (!reader.number(value)) {
+                        return;
+                    }
+                    builder.lineTo(glm::dvec2(origin.x + value,
+                                              builder.current.y));
+                    break;
+                case 'V':
+                    if (!reader.number(value)) {
+                        return;
+                    }
+                    builder.lineTo(glm::dvec2(builder.current.x,
+                                              origin.y + value));
+                    break;
+                case 'C':
+                    if (!reader.point(c1) || !reader.point(c2) ||
+                        !reader.point(p)) {
+                        return;
+                    }
+                    control = origin + c2;
+                    builder.cubicTo(origin + c1, control, origin + p);
+                    break;
+                case 'S':
+                    if (!reader.point(c2) || !reader.point(p)) {
+                        return;
+                    }
+                    c1 = previous == 'C' || previous == 'S'
+                             ? 2.0 * builder.current - control
+                             : builder.current;
+                    control = origin + c2;
+                    builder.cubicTo(c1, control, origin + p);
+                    break;
+                case 'Q':
+                    if (!reader.point(c1) || !reader.point(p)) {
+                        return;
+                    }
+                    control = origin + c1;
+                    builder.quadTo(control, origin + p);
+                    break;
+                case 'T':
+                    if (!reader.point(p)) {
+                        return;
+                    }
+                    control = previous == 'Q' || previous == 'T'
+                                  ? 2.0 * builder.current - control
+                                  : builder.current;
+                    builder.quadTo(control, origin + p);
+                    break;
+                case 'A': {
+                    glm::dvec2 radii;
+                    double rotation;
+                    bool largeArc, sweep;
+                    if (!reader.point(radii) || !reader.number(rotation) ||
+                        !reader.flag(largeArc) || !reader.flag(sweep) ||
+                        !reader.point(p)) {
+                        return;
+                    }
+                    builder.arcTo(radii.x, radii.y, rotation, largeArc, sweep,
+                                  origin + p);
+                    break;
+                }
+                default:
+                    return;
+            }
+            previous = upper == 'M' ? 'L' : upper;
+            first = false;
+        }
+    }
+}
+
+bool ImportSvg(const std::string& path, double tolerance,
+               std::vector<BiarcCurve>& curves) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        fprintf(stderr, "Cannot open %s\n", path.c_str());
+        return false;
+    }
+
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    ImportQueue queue;
+    queue.capacity = kQueuedPathsPerWorker * workers;
+    std::vector<std::thread> threads;
+    for (size_t k = 0; k < workers; ++k) {
+        threads.push_back(std::thread(&ImportQueue::work, &queue, tolerance));
+    }
+
+    SvgScanner scanner;
+    std::vector<char> buffer(kReadSize);
+    size_t size;
+    while ((size = fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+        scanner.scan(buffer.data(), size,
+                     [&queue](std::string& data) { queue.push(data); });
+    }
+    bool failed = ferror(file) != 0;
+    fclose(file);
+    queue.finish();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (failed) {
+        fprintf(stderr, "Error reading %s\n", path.c_str());
+        return false;
+    }
+
+    for (size_t i = 0; i < queue.results.size(); ++i) {
+        for (size_t k = 0; k < queue.results[i].size(); ++k) {
+            curves.push_back(std::move(queue.results[i][k]));
+        }
+        std::vector<BiarcCurve>().swap(queue.results[i]);
+    }
+    return true;
+}
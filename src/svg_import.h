@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "biarc.h"
+
+// Append the knots of biarcs that stay within tolerance pixels of the cubic
+// Bézier curve c[0] ... c[3]. The curve must already end at c[0], which is
+// not appended again.
+void CubicToBiarcs(const glm::dvec2 c[4], double tolerance,
+                   BiarcCurve& curve);
+
+// Parse SVG path data into one curve per subpath. Lines, quadratic curves
+// and elliptical arcs are converted to cubic curves first. Parsing stops at
+// the first error, keeping what came before, as SVG renderers do. Corners
+// become two knots a hundredth of a pixel apart. Closed subpaths do not
+// repeat their first knot at the end.
+void ParsePathData(const std::string& data, double tolerance,
+                   std::vector<BiarcCurve>& curves);
+
+// Append the curves of all <path> elements of an SVG file, in document
+// order. The file is scanned in small chunks, and the path data goes to a
+// pool of one worker per core through a short queue, so only a few paths
+// are held in memory at once besides the result. Transforms and other
+// shapes are ignored. Returns false if the file cannot be read.
+bool ImportSvg(const std::string& path, double tolerance,
+               std::vector<BiarcCurve>& curves);
@@ -0,0 +1,146 @@
+#include "tangents.h"
+
+#include <algorithm>
+#include <cmath>
+
+const char* const kTangentMethodNames[kTangentMethodCount] = {
+    "Central difference", "Catmull-Rom", "Bessel"};
+
+namespace {
+
+glm::dvec2 centralDifference(const glm::dvec2& prev, const glm::dvec2& next) {
+    glm::dvec2 t = next - prev;
+    if (std::abs(t.y) > 100.0) {
+        t.y = t.y > 0.0 ? 100.0 : -100.0;
+    }
+    return t;
+}
+
+glm::dvec2 catmullRom(const glm::dvec2& prev, const glm::dvec2& p,
+                      const glm::dvec2& next) {
+    // Knot intervals of the centripetal parametrization
+    double dt0 = std::sqrt(glm::distance(prev, p));
+    double dt1 = std::sqrt(glm::distance(p, next));
+    if (dt0 == 0.0 || dt1 == 0.0) {
+        return next - prev;
+    }
+    return (p - prev) / dt0 - (next - prev) / (dt0 + dt1) + (next - p) / dt1;
+}
+
+glm::dvec2 bessel(const glm::dvec2& prev, const glm::dvec2& p,
+                  const glm::dvec2& next) {
+    double d0 = glm::distance(prev, p);
+    double d1 = glm::distance(p, next);
+    if (d0 == 0.0 || d1 == 0.0) {
+        return next - prev;
+    }
+    return (d1 / d0 * (p - prev) + d0 / d1 * (next - p)) / (d0 + d1);
+}
+
+}  // namespace
+
+glm::dvec2 EstimateTangent(TangentMethod method,
+                           const std::vector<glm::dvec2>& points, size_t i) {
+    return EstimateTangent(method, points, i, 0, points.size() - 1);
+}
+
+glm::dvec2 EstimateTangent(TangentMethod method,
+                           const std::vector<glm::dvec2>& points, size_t i,
+                           size_t first, size_t last, bool closed) {
+    bool wraps = closed && last >= first + 2;
+    size_t prevIndex = i > first ? i - 1 : (wraps ? last : first);
+    size_t nextIndex = i < last ? i + 1 : (wraps ? first : last);
+    glm::dvec2 prev(points[prevIndex]);
+    glm::dvec2 p(points[i]);
+    glm::dvec2 next(points[nextIndex]);
+
+    glm::dvec2 t;
+    if (method == kCentralDifference || prevIndex == i || nextIndex == i) {
+        // End points only have a one-sided difference
+        t = centralDifference(prev, next);
+    } else if (method == kCatmullRom) {
+        t = catmullRom(prev, p, next);
+    } else {
+        t = bessel(prev, p, next);
+    }
+    return t / glm::length(t);
+}
+
+bool Tangents::isPinned(size_t i) const {
+    return pinned[i].x != 0.0f || pinned[i].y != 0.0f;
+}
+
+void Tangents::pin(size_t i, const glm::vec2& tangent) {
+    pinned[i] = glm::normalize(tangent);
+    values[i] = pinned[i];
+}
+
+void Tangents::unpin(size_t i) { pinned[i] = glm::vec2(0.0f); }
+
+void Tangents::rebuild(const std::vector<glm::dvec2>& points,
+                       const CurveTable& curves) {
+    if (points.empty()) {
+        values.clear();
+        pinned.clear();
+        return;
+    }
+    update(points, curves, 0, points.size() - 1);
+}
+
+void Tangents::insert(size_t i, size_t count) {
+    values.insert(values.begin() + std::min(i, values.size()), count,
+                  glm::vec2(0.0f));
+    pinned.insert(pinned.begin() + std::min(i, pinned.size()), count,
+                  glm::vec2(0.0f));
+}
+
+void Tangents::erase(size_t i, size_t count) {
+    values.erase(values.begin() + std::min(i, values.size()),
+                 values.begin() + std::min(i + count, values.size()));
+    pinned.erase(pinned.begin() + std::min(i, pinned.size()),
+                 pinned.begin() + std::min(i + count, pinned.size()));
+}
+
+void Tangents::update(const std::vector<glm::dvec2>& points,
+                      const CurveTable& curves, size_t first, size_t last) {
+    values.resize(points.size());
+    pinned.resize(points.size(), glm::vec2(0.0f));
+    if (points.size() < 2) {
+        return;
+    }
+    size_t begin = first > 0 ? first - 1 : 0;
+    size_t end = std::min(last + 1, points.size() - 1);
+    // Walk the curves alongside the points, a table that does not cover
+    // them yet counts as one open curve
+    size_t c = curves.curveAt(begin);
+    for (size_t i = begin; i <= end; ++i) {
+        while (c + 1 < curves.curves.size() &&
+               i >= curves.curves[c + 1].first) {
+            ++c;
+        }
+        estimate(points, curves, c, i);
+    }
+    size_t seams[2];
+    size_t seamCount = curves.seamNeighbors(first, last, seams);
+    for (size_t k = 0; k < seamCount; ++k) {
+        if (seams[k] < points.size()) {
+            estimate(points, curves, curves.curveAt(seams[k]), seams[k]);
+        }
+    }
+}
+
+void Tangents::estimate(const std::vector<glm::dvec2>& points,
+                        const CurveTable& curves, size_t c, size_t i) {
+    size_t curveFirst = 0, curveEnd = points.size();
+    bool closed = false;
+    if (c < curves.curves.size()) {
+        const Curve& curve = curves.curves[c];
+        curveFirst = curve.first;
+        curveEnd = std::max(curve.first + curve.count, i + 1);
+        closed = curve.closed && curveEnd == curve.first + curve.count;
+    }
+    values[i] = isPinned(i)
+                    ? pinned[i]
+                    : glm::vec2(EstimateTangent(method, points, i, curveFirst,
+                                                curveEnd - 1, closed));
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "curve_table.h"
+
+// Ways of estimating the tangent at a point from its neighbors
+enum TangentMethod {
+    // Central difference with the y-component clamped to +-100, which is
+    // what the shader used to compute per pixel
+    kCentralDifference,
+    // Centripetal Catmull-Rom
+    kCatmullRom,
+    // Derivative of the chord-length parabola through the point and its
+    // neighbors
+    kBessel,
+    kTangentMethodCount
+};
+
+extern const char* const kTangentMethodNames[kTangentMethodCount];
+
+// Unit tangent at point i
+glm::dvec2 EstimateTangent(TangentMethod method,
+                           const std::vector<glm::dvec2>& points, size_t i);
+// Unit tangent at point i of the curve of points first ... last. The ends
+// of an open curve only have one neighbor, those of a closed curve of more
+// than two points are each other's neighbors.
+glm::dvec2 EstimateTangent(TangentMethod method,
+                           const std::vector<glm::dvec2>& points, size_t i,
+                           size_t first, size_t last, bool closed = false);
+
+// Unit tangents of all points. Points with a pinned tangent keep it,
+// all others are estimated from their neighbors on the same curve, which
+// wrap around the seam of a closed curve.
+struct Tangents {
+    TangentMethod method = kCentralDifference;
+    std::vector<glm::vec2> values;
+    // Zero where the tangent is estimated
+    std::vector<glm::vec2> pinned;
+
+    bool isPinned(size_t i) const;
+    void pin(size_t i, const glm::vec2& tangent);
+    void unpin(size_t i);
+
+    void rebuild(const std::vector<glm::dvec2>& points,
+                 const CurveTable& curves);
+    // Make room for count points inserted at i, or drop the count points at
+    // i, along with their pinned tangents. The update for the points around
+    // the edit fills in the rest.
+    void insert(size_t i, size_t count);
+    void erase(size_t i, size_t count);
+    // Recompute the tangents affected by a change of the points
+    // first ... last, which are the ones of first - 1 ... last + 1 and the
+    // seam neighbor of a closed curve
+    void update(const std::vector<glm::dvec2>& points,
+                const CurveTable& curves, size_t first, size_t last);
+
+   private:
+    // Tangent of point i, which belongs to curve c of the table
+    void estimate(const std::vector<glm::dvec2>& points,
+                  const CurveTable& curves, size_t c, size_t i);
+};
@@ -0,0 +1,324 @@
+#include "tile_pyramid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "shader.h"
+
+namespace {
+
+// Quad of a tile part, from the vertex IDs of a triangle strip
+const char* tileVertexSource = R"(
+    #version 330 core
+    // Window box of the quad with y pointing down, and the window size
+    uniform vec4 rect;
+    uniform vec2 windowSize;
+    // Part of the tile in fractions with y pointing down
+    uniform vec4 part;
+
+    out vec2 uv;
+
+    void main() {
+        vec2 f = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+        vec2 p = mix(rect.xy, rect.zw, f);
+        vec2 a = mix(part.xy, part.zw, f);
+        // Tiles are drawn with the upper left origin, so their top row is
+        // the last texel row
+        uv = vec2(a.x, 1.0 - a.y);
+        vec2 ndc = 2.0 * p / windowSize - 1.0;
+        gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+    }
+)";
+
+const char* tileFragmentSource = R"(
+    #version 330 core
+    uniform sampler2DArray tiles;
+    uniform float layer;
+
+    in vec2 uv;
+    out vec4 fragColor;
+
+    void main() { fragColor = texture(tiles, vec3(uv, layer)); }
+)";
+
+const int kMinLevel = -30;
+const int kMaxLevel = 30;
+// Levels above a missing tile that are searched for a cached ancestor
+const int kFallbackLevels = 4;
+// Window pixels beyond the box of an edit that its drawing reaches, as in
+// the culling of the curves
+const double kEditMargin = 16.0;
+
+// x / 2^k rounded down, for negative x, too
+int64_t FloorShift(int64_t x, int k) {
+    return x >= 0 ? x >> k : -((-x - 1) >> k) - 1;
+}
+
+double TileWorldSize(int level) {
+    return std::ldexp(double(TilePyramid::kTileSize), -level);
+}
+
+// Tiles x0 ... x1 - 1 by y0 ... y1 - 1 of a level
+struct TileRange {
+    int level;
+    int64_t x0, y0, x1, y1;
+};
+
+TileRange VisibleTiles(const Camera& camera, int width, int height) {
+    TileRange range;
+    range.level = TileLevel(camera);
+    double size = TileWorldSize(range.level);
+    glm::dvec2 lo, hi;
+    camera.visibleBox(width, height, lo, hi);
+    range.x0 = static_cast<int64_t>(std::floor(lo.x / size));
+    range.y0 = static_cast<int64_t>(std::floor(lo.y / size));
+    range.x1 = static_cast<int64_t>(std::ceil(hi.x / size));
+    range.y1 = static_cast<int64_t>(std::ceil(hi.y / size));
+    return range;
+}
+
+}  // namespace
+
+bool TileKey::operator<(const TileKey& other) const {
+    if (level != other.level) {
+        return level < other.level;
+    }
+    return x != other.x ? x < other.x : y < other.y;
+}
+
+int TileLevel(const Camera& camera) {
+    int level = static_cast<int>(std::ceil(std::log2(camera.scale)));
+    return std::max(kMinLevel, std::min(kMaxLevel, level));
+}
+
+void TilePyramid::init() {
+    program = CreateProgram(tileVertexSource, &tileFragmentSource, 1);
+    glGenVertexArrays(1, &emptyVAO);
+    glGenFramebuffers(1, &fbo);
+    glGenTextures(1, &texture);
+    setBudget(budgetBytes);
+}
+
+void TilePyramid::setBudget(size_t bytes) {
+    budgetBytes = bytes;
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    size_t tileBytes = size_t(kTileSize) * kTileSize * 4;
+    layerCount = static_cast<GLint>(std::min(
+        std::max(budgetBytes / tileBytes, size_t(1)), size_t(maxLayers)));
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, kTileSize, kTileSize,
+                 layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    clear();
+}
+
+void TilePyramid::plan(const Camera& camera, int width, int height,
+                       std::vector<TileKey>& missing) {
+    ++frame;
+    missing.clear();
+    TileRange range = VisibleTiles(camera, width, height);
+    for (int64_t y = range.y0; y < range.y1; ++y) {
+        for (int64_t x = range.x0; x < range.x1; ++x) {
+            TileKey key = {range.level, x, y};
+            std::map<TileKey, Tile>::iterator it = tiles.find(key);
+            if (it != tiles.end()) {
+                it->second.shown = frame;
+            } else {
+                missing.push_back(key);
+            }
+        }
+    }
+
+    glm::dvec2 center =
+        0.5 * glm::dvec2(range.x0 + range.x1 - 1, range.y0 + range.y1 - 1);
+    std::sort(missing.begin(), missing.end(),
+              [&](const TileKey& a, const TileKey& b) {
+                  glm::dvec2 da = glm::dvec2(a.x, a.y) - center;
+                  glm::dvec2 db = glm::dvec2(b.x, b.y) - center;
+                  return glm::dot(da, da) < glm::dot(db, db);
+              });
+    if (missing.size() > static_cast<size_t>(maxDrawsPerFrame)) {
+        missing.resize(maxDrawsPerFrame);
+    }
+}
+
+Camera TilePyramid::tileCamera(const TileKey& key) const {
+    Camera camera;
+    double size = TileWorldSize(key.level);
+    camera.origin = glm::dvec2(key.x, key.y) * size;
+    camera.scale = std::ldexp(1.0, key.level);
+    return camera;
+}
+
+bool TilePyramid::beginTile(const TileKey& key) {
+    GLint layer;
+    if (!freeLayers.empty()) {
+        layer = freeLayers.back();
+        freeLayers.pop_back();
+    } else {
+        // Least recently shown tile, but none of this frame
+        std::map<TileKey, Tile>::iterator oldest = tiles.end();
+        for (std::map<TileKey, Tile>::iterator it = tiles.begin();
+             it != tiles.end(); ++it) {
+            if (it->second.shown < frame &&
+                (oldest == tiles.end() ||
+                 it->second.shown < oldest->second.shown)) {
+                oldest = it;
+            }
+        }
+        if (oldest == tiles.end()) {
+            return false;
+        }
+        layer = oldest->second.layer;
+        tiles.erase(oldest);
+    }
+    Tile tile = {layer, frame};
+    tiles[key] = tile;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture,
+                              0, layer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Tile framebuffer incomplete" << std::endl;
+    }
+    glViewport(0, 0, kTileSize, kTileSize);
+    return true;
+}
+
+void TilePyramid::draw(const Camera& camera, int width, int height) {
+    glUseProgram(program);
+    glActiveTexture(GL_TEXTURE11);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(program, "tiles"), 11);
+    glUniform2f(glGetUniformLocation(program, "windowSize"),
+                static_cast<GLfloat>(width), static_cast<GLfloat>(height));
+    glBindVertexArray(emptyVAO);
+
+    TileRange range = VisibleTiles(camera, width, height);
+    double size = TileWorldSize(range.level);
+    for (int64_t y = range.y0; y < range.y1; ++y) {
+        for (int64_t x = range.x0; x < range.x1; ++x) {
+            TileKey key = {range.level, x, y};
+            std::map<TileKey, Tile>::const_iterator it = tiles.find(key);
+            if (it == tiles.end()) {
+                drawFallback(key, camera);
+                continue;
+            }
+            glm::dvec2 origin = glm::dvec2(x, y) * size;
+            drawTile(it->second, glm::dvec2(0.0), glm::dvec2(1.0),
+                     camera.toView(origin),
+                     camera.toView(origin + glm::dvec2(size)));
+        }
+    }
+    glBindVertexArray(0);
+}
+
+void TilePyramid::drawTile(const Tile& tile, const glm::dvec2& lo,
+                           const glm::dvec2& hi, const glm::dvec2& viewLo,
+                           const glm::dvec2& viewHi) {
+    glUniform4f(glGetUniformLocation(program, "rect"),
+                static_cast<GLfloat>(viewLo.x), static_cast<GLfloat>(viewLo.y),
+                static_cast<GLfloat>(viewHi.x),
+                static_cast<GLfloat>(viewHi.y));
+    glUniform4f(glGetUniformLocation(program, "part"),
+                static_cast<GLfloat>(lo.x), static_cast<GLfloat>(lo.y),
+                static_cast<GLfloat>(hi.x), static_cast<GLfloat>(hi.y));
+    glUniform1f(glGetUniformLocation(program, "layer"),
+                static_cast<GLfloat>(tile.layer));
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void TilePyramid::drawFallback(const TileKey& key, const Camera& camera) {
+    double size = TileWorldSize(key.level);
+    glm::dvec2 origin = glm::dvec2(key.x, key.y) * size;
+    glm::dvec2 viewLo = camera.toView(origin);
+    glm::dvec2 viewHi = camera.toView(origin + glm::dvec2(size));
+
+    // The part of the nearest cached ancestor, upsampled
+    for (int k = 1; k <= kFallbackLevels && key.level - k >= kMinLevel; ++k) {
+        TileKey parent = {key.level - k, FloorShift(key.x, k),
+                          FloorShift(key.y, k)};
+        std::map<TileKey, Tile>::iterator it = tiles.find(parent);
+        if (it == tiles.end()) {
+            continue;
+        }
+        it->second.shown = frame;
+        double parentSize = TileWorldSize(parent.level);
+        glm::dvec2 parentOrigin = glm::dvec2(parent.x, parent.y) * parentSize;
+        glm::dvec2 lo = (origin - parentOrigin) / parentSize;
+        drawTile(it->second, lo, lo + glm::dvec2(size / parentSize), viewLo,
+                 viewHi);
+        return;
+    }
+
+    // Otherwise the cached children, downsampled
+    if (key.level >= kMaxLevel) {
+        return;
+    }
+    for (int k = 0; k < 4; ++k) {
+        TileKey child = {key.level + 1, 2 * key.x + (k & 1),
+                         2 * key.y + (k >> 1)};
+        std::map<TileKey, Tile>::iterator it = tiles.find(child);
+        if (it == tiles.end()) {
+            continue;
+        }
+        it->second.shown = frame;
+        glm::dvec2 childOrigin = origin + 0.5 * size * glm::dvec2(k & 1, k >> 1);
+        drawTile(it->second, glm::dvec2(0.0), glm::dvec2(1.0),
+                 camera.toView(childOrigin),
+                 camera.toView(childOrigin + glm::dvec2(0.5 * size)));
+    }
+}
+
+void TilePyramid::invalidate(const glm::dvec2& lo, const glm::dvec2& hi,
+                             bool open) {
+    std::map<TileKey, Tile>::iterator it = tiles.begin();
+    while (it != tiles.end()) {
+        const TileKey& key = it->first;
+        double size = TileWorldSize(key.level);
+        glm::dvec2 margin(kEditMargin / std::ldexp(1.0, key.level));
+        glm::dvec2 tileLo = glm::dvec2(key.x, key.y) * size - margin;
+        glm::dvec2 tileHi = tileLo + glm::dvec2(size) + 2.0 * margin;
+        bool overlaps = tileHi.x >= lo.x && tileLo.x <= hi.x &&
+                        tileLo.y <= hi.y && (open || tileHi.y >= lo.y);
+        if (overlaps) {
+            freeLayers.push_back(it->second.layer);
+            it = tiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void TilePyramid::clear() {
+    tiles.clear();
+    freeLayers.clear();
+    for (GLint layer = layerCount - 1; layer >= 0; --layer) {
+        freeLayers.push_back(layer);
+    }
+}
+
+void TilePyramid::setMode(int newMode) {
+    if (newMode != mode) {
+        mode = newMode;
+        clear();
+    }
+}
+
+size_t TilePyramid::gpuBytes() const {
+    return size_t(layerCount) * kTileSize * kTileSize * 4;
+}
+
+void TilePyramid::cleanup() {
+    glDeleteProgram(program);
+    glDeleteVertexArrays(1, &emptyVAO);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &texture);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <map>
+#include <vector>
+
+#include "camera.h"
+
+// Tile of the pyramid: level l has 2^l window pixels per world unit, and
+// tile (x, y) covers the world from (x, y) to (x + 1, y + 1) times the tile
+// size over that scale. The four tiles of level l + 1 within a tile are its
+// children.
+struct TileKey {
+    int level;
+    int64_t x, y;
+
+    bool operator<(const TileKey& other) const;
+};
+
+// Cache of the curves drawn into square tiles at power of two scales, a
+// quadtree over the infinite canvas. Each tile is one layer of an array
+// texture. The layers fit a GPU memory budget, and the least recently shown
+// tile makes room for a new one. A frame shows the tiles of the level at or
+// just above the camera's scale and only draws the missing ones, a few per
+// frame. Until then the region shows the part of a cached ancestor or the
+// cached children. Edits only drop the tiles that overlap the boxes of the
+// segments that changed.
+struct TilePyramid {
+    static const int kTileSize = 256;
+
+    // Tiles drawn per frame at most
+    int maxDrawsPerFrame = 8;
+
+    void init();
+    // Reallocate the layers for a GPU memory budget, which drops all tiles
+    void setBudget(size_t bytes);
+    // Tiles of the view that are missing, at most maxDrawsPerFrame, nearest
+    // to the center first
+    void plan(const Camera& camera, int width, int height,
+              std::vector<TileKey>& missing);
+    // Camera that draws the tile into a kTileSize square viewport
+    Camera tileCamera(const TileKey& key) const;
+    // Bind the framebuffer to the layer of a tile that is about to be drawn,
+    // evicting the least recently shown tile if needed. False if every
+    // layer holds a tile of this frame.
+    bool beginTile(const TileKey& key);
+    // Draw the tiles of the view into the current framebuffer
+    void draw(const Camera& camera, int width, int height);
+    // Drop the tiles that overlap the world box. With open, also the ones
+    // above it, whose even-odd rays pass the box.
+    void invalidate(const glm::dvec2& lo, const glm::dvec2& hi, bool open);
+    // Drop all tiles
+    void clear();
+    // Settings the tiles are drawn with, a change drops all tiles
+    void setMode(int newMode);
+    size_t tileCount() const { return tiles.size(); }
+    size_t budget() const { return budgetBytes; }
+    size_t gpuBytes() const;
+    void cleanup();
+
+   private:
+    struct Tile {
+        GLint layer;
+        // Frame the tile was last shown in
+        uint64_t shown;
+    };
+
+    GLuint program, emptyVAO;
+    GLuint fbo, texture;
+    size_t budgetBytes = size_t(64) << 20;
+    GLint layerCount = 0;
+    std::map<TileKey, Tile> tiles;
+    std::vector<GLint> freeLayers;
+    uint64_t frame = 0;
+    int mode = 0;
+
+    // Draw the part lo ... hi, in fractions of the tile, of a cached tile
+    // onto the window box of the part
+    void drawTile(const Tile& tile, const glm::dvec2& lo,
+                  const glm::dvec2& hi, const glm::dvec2& viewLo,
+                  const glm::dvec2& viewHi);
+    // Draw a missing tile from an ancestor or its children, whatever is
+    // cached
+    void drawFallback(const TileKey& key, const Camera& camera);
+};
+
+// Level whose tiles show the view of the camera at no less than its scale
+int TileLevel(const Camera& camera);